@@ -0,0 +1,284 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+/*
+ * Columnar file format
+ * ====================
+ *
+ * A file holds a table of byte-string values, split horizontally into row
+ * groups and stored column by column within each group, so that a reader
+ * can access one column without touching the others. All integers are
+ * unsigned 64-bit little-endian.
+ *
+ *     file      := magic row_group* footer footer_size magic
+ *     magic     := "WARCCOL1"
+ *     row_group := chunk{column_count}
+ *     chunk     := end_offset{rows} value_bytes
+ *     footer    := column_count (name_size name){column_count}
+ *                  row_group_count (rows (chunk_offset chunk_size){column_count}){row_group_count}
+ *
+ * In a chunk, `end_offset[i]` is the end of value `i` relative to the first
+ * value byte; value `i` begins where value `i - 1` ends (or at 0). Chunk
+ * offsets are relative to the beginning of the file, and `footer_size` is
+ * the size of `footer`, which is read first.
+ */
+
+namespace detail {
+
+    constexpr std::string_view columnar_magic = "WARCCOL1";
+
+} // namespace detail
+
+/**
+ * Writes rows of values to a stream in the columnar format.
+ *
+ * Values are buffered per column until the row group reaches `row_group_size`
+ * bytes; then the group is written one column after another. `finish`
+ * writes the last group and the footer; the destructor calls it if it has
+ * not been called, but ignores errors.
+ */
+class Column_Writer {
+   private:
+    std::ostream *os_;
+    std::vector<std::string> names_;
+    std::vector<std::string> offsets_;
+    std::vector<std::string> values_;
+    std::size_t row_group_size_;
+    std::size_t buffered_ = 0;
+    std::uint64_t rows_ = 0;
+    std::uint64_t position_ = 0;
+    std::uint64_t row_groups_ = 0;
+    std::string groups_footer_;
+    bool finished_ = false;
+
+    void write(std::string_view data)
+    {
+        if (not os_->write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            throw std::runtime_error("could not write columnar output");
+        }
+        position_ += data.size();
+    }
+
+    void flush_row_group()
+    {
+        if (rows_ == 0) {
+            return;
+        }
+        detail::put_u64(groups_footer_, rows_);
+        for (std::size_t column = 0; column < names_.size(); ++column) {
+            detail::put_u64(groups_footer_, position_);
+            detail::put_u64(groups_footer_, offsets_[column].size() + values_[column].size());
+            write(offsets_[column]);
+            write(values_[column]);
+            offsets_[column].clear();
+            values_[column].clear();
+        }
+        ++row_groups_;
+        rows_ = 0;
+        buffered_ = 0;
+    }
+
+   public:
+    static constexpr std::size_t default_row_group_size = 64U << 20U;
+
+    Column_Writer(std::ostream &os,
+                  std::vector<std::string> names,
+                  std::size_t row_group_size = default_row_group_size)
+        : os_(&os),
+          names_(std::move(names)),
+          offsets_(names_.size()),
+          values_(names_.size()),
+          row_group_size_(row_group_size)
+    {
+        write(detail::columnar_magic);
+    }
+    Column_Writer(Column_Writer const &) = delete;
+    Column_Writer &operator=(Column_Writer const &) = delete;
+    ~Column_Writer()
+    {
+        try {
+            finish();
+        } catch (...) {
+        }
+    }
+
+    /// Appends a row; throws `std::invalid_argument` unless there is one value per column.
+    void write_row(std::initializer_list<std::string_view> values)
+    {
+        if (values.size() != names_.size()) {
+            throw std::invalid_argument("row size does not match the number of columns");
+        }
+        std::size_t column = 0;
+        for (auto value : values) {
+            values_[column].append(value.data(), value.size());
+            detail::put_u64(offsets_[column], values_[column].size());
+            buffered_ += value.size() + 8;
+            ++column;
+        }
+        ++rows_;
+        if (buffered_ >= row_group_size_) {
+            flush_row_group();
+        }
+    }
+
+    /// Writes the last row group and the footer.
+    void finish()
+    {
+        if (finished_) {
+            return;
+        }
+        finished_ = true;
+        flush_row_group();
+        std::string footer;
+        detail::put_u64(footer, names_.size());
+        for (auto const &name : names_) {
+            detail::put_u64(footer, name.size());
+            footer += name;
+        }
+        detail::put_u64(footer, row_groups_);
+        footer += groups_footer_;
+        detail::put_u64(footer, footer.size());
+        footer += detail::columnar_magic;
+        write(footer);
+        os_->flush();
+    }
+};
+
+/// Values of one column in one row group.
+class Column_View {
+   private:
+    char const *offsets_ = nullptr;
+    char const *values_ = nullptr;
+    std::size_t size_ = 0;
+
+   public:
+    Column_View() = default;
+    Column_View(char const *offsets, char const *values, std::size_t size)
+        : offsets_(offsets), values_(values), size_(size)
+    {}
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+    [[nodiscard]] auto operator[](std::size_t row) const noexcept -> std::string_view
+    {
+        auto begin = row == 0 ? 0 : detail::get_u64(offsets_ + 8 * (row - 1));
+        auto end = detail::get_u64(offsets_ + 8 * row);
+        return {values_ + begin, static_cast<std::size_t>(end - begin)};
+    }
+};
+
+/**
+ * Reads a columnar file held in memory, typically a `Mapped_File`.
+ *
+ * Only the footer is parsed on construction; `column` then locates a single
+ * column chunk, so reading one column does not touch the pages of others.
+ * Throws `std::runtime_error` if the data is not a well-formed columnar file.
+ */
+class Column_Reader {
+   private:
+    struct Chunk {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+    std::string_view data_;
+    std::vector<std::string> names_;
+    std::vector<std::uint64_t> rows_;
+    std::vector<Chunk> chunks_;
+
+    [[noreturn]] static void fail() { throw std::runtime_error("invalid columnar file"); }
+
+   public:
+    explicit Column_Reader(std::string_view data) : data_(data)
+    {
+        auto magic_size = detail::columnar_magic.size();
+        if (data.size() < 2 * magic_size + 8 ||
+            data.substr(0, magic_size) != detail::columnar_magic ||
+            data.substr(data.size() - magic_size) != detail::columnar_magic) {
+            fail();
+        }
+        auto footer_size = detail::get_u64(data.data() + data.size() - magic_size - 8);
+        if (footer_size > data.size() - 2 * magic_size - 8) {
+            fail();
+        }
+        auto footer = data.substr(data.size() - magic_size - 8 - footer_size, footer_size);
+        auto next = [&] {
+            if (footer.size() < 8) {
+                fail();
+            }
+            auto value = detail::get_u64(footer.data());
+            footer.remove_prefix(8);
+            return value;
+        };
+        auto columns = next();
+        for (std::uint64_t column = 0; column < columns; ++column) {
+            auto size = next();
+            if (size > footer.size()) {
+                fail();
+            }
+            names_.emplace_back(footer.substr(0, size));
+            footer.remove_prefix(size);
+        }
+        auto row_groups = next();
+        for (std::uint64_t group = 0; group < row_groups; ++group) {
+            auto rows = next();
+            for (std::uint64_t column = 0; column < columns; ++column) {
+                Chunk chunk{next(), next()};
+                if (chunk.offset > data.size() || chunk.size > data.size() - chunk.offset ||
+                    rows > chunk.size / 8) {
+                    fail();
+                }
+                chunks_.push_back(chunk);
+            }
+            rows_.push_back(rows);
+        }
+    }
+
+    [[nodiscard]] auto names() const noexcept -> std::vector<std::string> const & { return names_; }
+
+    [[nodiscard]] auto column_index(std::string_view name) const -> std::optional<std::size_t>
+    {
+        for (std::size_t column = 0; column < names_.size(); ++column) {
+            if (names_[column] == name) {
+                return column;
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] auto row_groups() const noexcept -> std::size_t { return rows_.size(); }
+    [[nodiscard]] auto rows(std::size_t group) const -> std::size_t { return rows_.at(group); }
+
+    /// Returns the values of `column` in `group`, checking that they lie within the chunk.
+    [[nodiscard]] auto column(std::size_t group, std::size_t column) const -> Column_View
+    {
+        if (column >= names_.size()) {
+            throw std::out_of_range("column index out of range");
+        }
+        auto rows = rows_.at(group);
+        auto chunk = chunks_[group * names_.size() + column];
+        char const *offsets = data_.data() + chunk.offset;
+        std::uint64_t previous = 0;
+        for (std::uint64_t row = 0; row < rows; ++row) {
+            auto end = detail::get_u64(offsets + 8 * row);
+            if (end < previous || end > chunk.size - 8 * rows) {
+                fail();
+            }
+            previous = end;
+        }
+        return Column_View(offsets, offsets + 8 * rows, static_cast<std::size_t>(rows));
+    }
+};
+
+} // namespace warcpp
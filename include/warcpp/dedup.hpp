@@ -0,0 +1,282 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "digest.hpp"
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+/// 128-bit key identifying a payload; `{0, 0}` is reserved by `Digest_Set`.
+struct Hash_128 {
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+
+    [[nodiscard]] auto operator==(Hash_128 const &other) const noexcept -> bool
+    {
+        return high == other.high && low == other.low;
+    }
+    [[nodiscard]] auto operator!=(Hash_128 const &other) const noexcept -> bool
+    {
+        return not(*this == other);
+    }
+};
+
+namespace detail {
+
+    constexpr std::array<std::uint64_t, 4> hash_primes = {
+        0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL};
+
+    /// Folds the 128-bit product of `lhs` and `rhs` into 64 bits.
+    [[nodiscard]] inline auto multiply_fold(std::uint64_t lhs, std::uint64_t rhs) noexcept
+        -> std::uint64_t
+    {
+        auto product = static_cast<unsigned __int128>(lhs) * rhs;
+        return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64U);
+    }
+
+    /**
+     * Anonymous or file-backed shared memory mapping. A file-backed region
+     * is unlinked as soon as it is mapped, so the file is only scratch space
+     * that the kernel can write back instead of swapping.
+     */
+    class Mapped_Region {
+       private:
+        void *data_ = nullptr;
+        std::size_t size_ = 0;
+
+       public:
+        Mapped_Region() = default;
+        explicit Mapped_Region(std::size_t size, std::string const &path = {}) : size_(size)
+        {
+            if (size_ == 0) {
+                return;
+            }
+            if (path.empty()) {
+                data_ = ::mmap(
+                    nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            } else {
+                int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+                if (fd < 0) {
+                    throw std::runtime_error("could not create file: " + path);
+                }
+                ::unlink(path.c_str());
+                if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("could not resize file: " + path);
+                }
+                data_ = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                ::close(fd);
+            }
+            if (data_ == MAP_FAILED) {
+                data_ = nullptr;
+                throw std::runtime_error("could not map memory");
+            }
+        }
+        Mapped_Region(Mapped_Region const &) = delete;
+        Mapped_Region &operator=(Mapped_Region const &) = delete;
+        Mapped_Region(Mapped_Region &&other) noexcept
+            : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+        {}
+        Mapped_Region &operator=(Mapped_Region &&other) noexcept
+        {
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            return *this;
+        }
+        ~Mapped_Region()
+        {
+            if (data_ != nullptr) {
+                ::munmap(data_, size_);
+            }
+        }
+
+        [[nodiscard]] auto data() const noexcept -> void * { return data_; }
+        [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+    };
+
+} // namespace detail
+
+/**
+ * Fast non-cryptographic 128-bit hash, reading 32 bytes per step in two
+ * independent multiply-fold lanes. It is meant to tell payloads apart,
+ * not to resist crafted collisions.
+ */
+[[nodiscard]] inline auto hash_128(std::string_view data, std::uint64_t seed = 0) noexcept
+    -> Hash_128
+{
+    auto const &primes = detail::hash_primes;
+    auto first = seed ^ primes[0];
+    auto second = seed ^ primes[1];
+    auto step = [&](char const *block) {
+        first = detail::multiply_fold(detail::get_u64(block) ^ primes[1],
+                                      detail::get_u64(block + 8) ^ first);
+        second = detail::multiply_fold(detail::get_u64(block + 16) ^ primes[2],
+                                       detail::get_u64(block + 24) ^ second);
+    };
+    char const *pos = data.data();
+    auto remaining = data.size();
+    for (; remaining >= 32; remaining -= 32, pos += 32) {
+        step(pos);
+    }
+    if (remaining > 0) {
+        char tail[32] = {};
+        std::memcpy(tail, pos, remaining);
+        step(tail);
+    }
+    first ^= static_cast<std::uint64_t>(data.size());
+    auto high = detail::multiply_fold(first ^ primes[3], second ^ primes[0]);
+    auto low = detail::multiply_fold(second ^ primes[2], high ^ first);
+    return {high, low};
+}
+
+/**
+ * Returns the first 128 bits of the digest in a `WARC-Payload-Digest` value
+ * such as `sha1:BASE32`, or `std::nullopt` if it cannot be decoded.
+ */
+[[nodiscard]] inline auto digest_key(std::string_view digest) -> std::optional<Hash_128>
+{
+    auto colon = digest.find(':');
+    if (colon == std::string_view::npos) {
+        return std::nullopt;
+    }
+    auto algorithm = digest.substr(0, colon);
+    std::size_t size = 0;
+    if (detail::iequals(algorithm, "sha1")) {
+        size = 20;
+    } else if (detail::iequals(algorithm, "sha256") || detail::iequals(algorithm, "sha-256")) {
+        size = 32;
+    } else {
+        return std::nullopt;
+    }
+    auto bytes = decode_digest(detail::trim_view(digest.substr(colon + 1)), size);
+    if (not bytes) {
+        return std::nullopt;
+    }
+    return Hash_128{detail::get_u64(bytes->data()), detail::get_u64(bytes->data() + 8)};
+}
+
+/**
+ * Returns the deduplication key of a `Record` or `Record_View`: the key of
+ * its `WARC-Payload-Digest` if it has a valid one, and otherwise `hash_128`
+ * of its payload (see `record_payload`).
+ */
+template <typename Record_Type>
+[[nodiscard]] auto payload_key(Record_Type const &record) -> Hash_128
+{
+    auto const &fields = record.fields();
+    if (auto const *digest = fields.get(Field::Warc_Payload_Digest); digest != nullptr) {
+        if (auto key = digest_key(*digest); key) {
+            return *key;
+        }
+    }
+    auto const *content_type = fields.get(Field::Content_Type);
+    auto type = content_type != nullptr ? std::string_view(*content_type) : std::string_view{};
+    return hash_128(record_payload(record.content(), type));
+}
+
+/**
+ * Set of 128-bit keys with open addressing and linear probing, holding
+ * 16 bytes per slot at a load factor of at most 3/4.
+ *
+ * Slots are in anonymous memory until the table would exceed
+ * `memory_limit` bytes; larger tables are mapped from a file at
+ * `spill_path`, if given, so that the page cache rather than swap backs
+ * them. Keys are expected to be uniformly distributed, as digests and
+ * `hash_128` values are. Not thread-safe.
+ */
+class Digest_Set {
+   private:
+    detail::Mapped_Region region_;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t memory_limit_;
+    std::string spill_path_;
+    bool spilled_ = false;
+
+    [[nodiscard]] auto slots() const noexcept -> Hash_128 *
+    {
+        return static_cast<Hash_128 *>(region_.data());
+    }
+
+    /// Position of `key` or of the empty slot where it belongs.
+    [[nodiscard]] auto probe(Hash_128 key) const noexcept -> std::size_t
+    {
+        auto mask = capacity_ - 1;
+        auto pos = static_cast<std::size_t>(key.low) & mask;
+        while (slots()[pos] != Hash_128{} && slots()[pos] != key) {
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    void grow()
+    {
+        auto capacity = capacity_ == 0 ? std::size_t(1) << 16U : capacity_ * 2;
+        auto bytes = capacity * sizeof(Hash_128);
+        bool spill = bytes > memory_limit_ && not spill_path_.empty();
+        detail::Mapped_Region region(bytes, spill ? spill_path_ : std::string{});
+        std::swap(region_, region);
+        auto const *old_slots = static_cast<Hash_128 const *>(region.data());
+        auto old_capacity = capacity_;
+        capacity_ = capacity;
+        spilled_ = spill;
+        for (std::size_t idx = 0; idx < old_capacity; ++idx) {
+            if (old_slots[idx] != Hash_128{}) {
+                slots()[probe(old_slots[idx])] = old_slots[idx];
+            }
+        }
+    }
+
+    [[nodiscard]] static auto non_empty(Hash_128 key) noexcept -> Hash_128
+    {
+        return key == Hash_128{} ? Hash_128{0, 1} : key;
+    }
+
+   public:
+    explicit Digest_Set(std::size_t memory_limit = std::size_t(1) << 30U,
+                        std::string spill_path = {})
+        : memory_limit_(memory_limit), spill_path_(std::move(spill_path))
+    {}
+
+    /// Inserts `key`; returns `false` if it was already present.
+    auto insert(Hash_128 key) -> bool
+    {
+        key = non_empty(key);
+        if ((size_ + 1) * 4 > capacity_ * 3) {
+            grow();
+        }
+        auto pos = probe(key);
+        if (slots()[pos] == key) {
+            return false;
+        }
+        slots()[pos] = key;
+        ++size_;
+        return true;
+    }
+
+    [[nodiscard]] auto contains(Hash_128 key) const noexcept -> bool
+    {
+        key = non_empty(key);
+        return capacity_ > 0 && slots()[probe(key)] == key;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+    [[nodiscard]] auto capacity() const noexcept -> std::size_t { return capacity_; }
+    /// Whether the slots are mapped from the spill file.
+    [[nodiscard]] auto spilled() const noexcept -> bool { return spilled_; }
+};
+
+} // namespace warcpp
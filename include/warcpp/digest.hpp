@@ -0,0 +1,529 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+namespace detail {
+
+    [[nodiscard]] inline auto load_be32(unsigned char const *data) noexcept -> std::uint32_t
+    {
+        return (static_cast<std::uint32_t>(data[0]) << 24U) |
+               (static_cast<std::uint32_t>(data[1]) << 16U) |
+               (static_cast<std::uint32_t>(data[2]) << 8U) | static_cast<std::uint32_t>(data[3]);
+    }
+
+    [[nodiscard]] constexpr auto rotl(std::uint32_t value, unsigned shift) noexcept -> std::uint32_t
+    {
+        return (value << shift) | (value >> (32U - shift));
+    }
+
+    [[nodiscard]] constexpr auto rotr(std::uint32_t value, unsigned shift) noexcept -> std::uint32_t
+    {
+        return (value >> shift) | (value << (32U - shift));
+    }
+
+    inline void sha1_compress_scalar(std::array<std::uint32_t, 5> &state,
+                                     unsigned char const *blocks,
+                                     std::size_t count) noexcept
+    {
+        for (; count > 0; --count, blocks += 64) {
+            std::array<std::uint32_t, 80> w{};
+            for (std::size_t t = 0; t < 16; ++t) {
+                w[t] = load_be32(blocks + 4 * t);
+            }
+            for (std::size_t t = 16; t < 80; ++t) {
+                w[t] = rotl(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+            }
+            auto [a, b, c, d, e] = state;
+            for (std::size_t t = 0; t < 80; ++t) {
+                std::uint32_t f = 0;
+                std::uint32_t k = 0;
+                if (t < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999U;
+                } else if (t < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1U;
+                } else if (t < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDCU;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6U;
+                }
+                auto temp = rotl(a, 5) + f + e + k + w[t];
+                e = d;
+                d = c;
+                c = rotl(b, 30);
+                b = a;
+                a = temp;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+    }
+
+    constexpr std::array<std::uint32_t, 64> sha256_constants = {
+        0x428A2F98U, 0x71374491U, 0xB5C0FBCFU, 0xE9B5DBA5U, 0x3956C25BU, 0x59F111F1U, 0x923F82A4U,
+        0xAB1C5ED5U, 0xD807AA98U, 0x12835B01U, 0x243185BEU, 0x550C7DC3U, 0x72BE5D74U, 0x80DEB1FEU,
+        0x9BDC06A7U, 0xC19BF174U, 0xE49B69C1U, 0xEFBE4786U, 0x0FC19DC6U, 0x240CA1CCU, 0x2DE92C6FU,
+        0x4A7484AAU, 0x5CB0A9DCU, 0x76F988DAU, 0x983E5152U, 0xA831C66DU, 0xB00327C8U, 0xBF597FC7U,
+        0xC6E00BF3U, 0xD5A79147U, 0x06CA6351U, 0x14292967U, 0x27B70A85U, 0x2E1B2138U, 0x4D2C6DFCU,
+        0x53380D13U, 0x650A7354U, 0x766A0ABBU, 0x81C2C92EU, 0x92722C85U, 0xA2BFE8A1U, 0xA81A664BU,
+        0xC24B8B70U, 0xC76C51A3U, 0xD192E819U, 0xD6990624U, 0xF40E3585U, 0x106AA070U, 0x19A4C116U,
+        0x1E376C08U, 0x2748774CU, 0x34B0BCB5U, 0x391C0CB3U, 0x4ED8AA4AU, 0x5B9CCA4FU, 0x682E6FF3U,
+        0x748F82EEU, 0x78A5636FU, 0x84C87814U, 0x8CC70208U, 0x90BEFFFAU, 0xA4506CEBU, 0xBEF9A3F7U,
+        0xC67178F2U};
+
+    inline void sha256_compress_scalar(std::array<std::uint32_t, 8> &state,
+                                       unsigned char const *blocks,
+                                       std::size_t count) noexcept
+    {
+        for (; count > 0; --count, blocks += 64) {
+            std::array<std::uint32_t, 64> w{};
+            for (std::size_t t = 0; t < 16; ++t) {
+                w[t] = load_be32(blocks + 4 * t);
+            }
+            for (std::size_t t = 16; t < 64; ++t) {
+                auto s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3U);
+                auto s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10U);
+                w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+            }
+            auto [a, b, c, d, e, f, g, h] = state;
+            for (std::size_t t = 0; t < 64; ++t) {
+                auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+                auto choice = (e & f) ^ (~e & g);
+                auto temp1 = h + s1 + choice + sha256_constants[t] + w[t];
+                auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+                auto majority = (a & b) ^ (a & c) ^ (b & c);
+                auto temp2 = s0 + majority;
+                h = g;
+                g = f;
+                f = e;
+                e = d + temp1;
+                d = c;
+                c = b;
+                b = a;
+                a = temp1 + temp2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+    /**
+     * Four SHA-1 rounds (group `G` of 20) with SHA-NI instructions, while
+     * computing the message schedule of later groups. `e` alternates between
+     * the two E registers.
+     */
+    template <int G>
+    inline void sha1_group(__m128i &abcd,
+                           __m128i (&e)[2],
+                           __m128i (&msg)[4],
+                           unsigned char const *block,
+                           __m128i mask) noexcept
+    {
+        auto &cur = msg[G % 4];
+        if constexpr (G < 4) {
+            cur = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(block + 16 * G)), mask);
+        }
+        if constexpr (G == 0) {
+            e[0] = _mm_add_epi32(e[0], cur);
+        } else {
+            e[G % 2] = _mm_sha1nexte_epu32(e[G % 2], cur);
+        }
+        e[1 - G % 2] = abcd;
+        if constexpr (G >= 3 && G <= 18) {
+            msg[(G + 1) % 4] = _mm_sha1msg2_epu32(msg[(G + 1) % 4], cur);
+        }
+        abcd = _mm_sha1rnds4_epu32(abcd, e[G % 2], G / 5);
+        if constexpr (G >= 1 && G <= 16) {
+            msg[(G + 3) % 4] = _mm_sha1msg1_epu32(msg[(G + 3) % 4], cur);
+        }
+        if constexpr (G >= 2 && G <= 17) {
+            msg[(G + 2) % 4] = _mm_xor_si128(msg[(G + 2) % 4], cur);
+        }
+    }
+
+    template <int... Gs>
+    inline void sha1_compress_shani(std::array<std::uint32_t, 5> &state,
+                                    unsigned char const *blocks,
+                                    std::size_t count,
+                                    std::integer_sequence<int, Gs...>) noexcept
+    {
+        auto const mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+        auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i *>(state.data())),
+                                      0x1B);
+        auto e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+        for (; count > 0; --count, blocks += 64) {
+            auto abcd_save = abcd;
+            auto e0_save = e0;
+            __m128i e[2] = {e0, e0};
+            __m128i msg[4] = {};
+            (sha1_group<Gs>(abcd, e, msg, blocks, mask), ...);
+            e0 = _mm_sha1nexte_epu32(e[0], e0_save);
+            abcd = _mm_add_epi32(abcd, abcd_save);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data()), _mm_shuffle_epi32(abcd, 0x1B));
+        state[4] = static_cast<std::uint32_t>(_mm_extract_epi32(e0, 3));
+    }
+
+    /// Four SHA-256 rounds (group `G` of 16) with SHA-NI instructions.
+    template <int G>
+    inline void sha256_group(__m128i &state0,
+                             __m128i &state1,
+                             __m128i (&msg)[4],
+                             unsigned char const *block,
+                             __m128i mask) noexcept
+    {
+        auto &cur = msg[G % 4];
+        if constexpr (G < 4) {
+            cur = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(block + 16 * G)), mask);
+        }
+        auto constants =
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(sha256_constants.data() + 4 * G));
+        auto words = _mm_add_epi32(cur, constants);
+        state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+        if constexpr (G >= 3 && G <= 14) {
+            auto &next = msg[(G + 1) % 4];
+            next = _mm_add_epi32(next, _mm_alignr_epi8(cur, msg[(G + 3) % 4], 4));
+            next = _mm_sha256msg2_epu32(next, cur);
+        }
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(words, 0x0E));
+        if constexpr (G >= 1 && G <= 12) {
+            msg[(G + 3) % 4] = _mm_sha256msg1_epu32(msg[(G + 3) % 4], cur);
+        }
+    }
+
+    template <int... Gs>
+    inline void sha256_compress_shani(std::array<std::uint32_t, 8> &state,
+                                      unsigned char const *blocks,
+                                      std::size_t count,
+                                      std::integer_sequence<int, Gs...>) noexcept
+    {
+        auto const mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        auto cdab = _mm_shuffle_epi32(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(state.data())), 0xB1);
+        auto efgh = _mm_shuffle_epi32(
+            _mm_loadu_si128(reinterpret_cast<__m128i const *>(state.data() + 4)), 0x1B);
+        auto state0 = _mm_alignr_epi8(cdab, efgh, 8);     // ABEF
+        auto state1 = _mm_blend_epi16(efgh, cdab, 0xF0);  // CDGH
+        for (; count > 0; --count, blocks += 64) {
+            auto abef_save = state0;
+            auto cdgh_save = state1;
+            __m128i msg[4] = {};
+            (sha256_group<Gs>(state0, state1, msg, blocks, mask), ...);
+            state0 = _mm_add_epi32(state0, abef_save);
+            state1 = _mm_add_epi32(state1, cdgh_save);
+        }
+        auto feba = _mm_shuffle_epi32(state0, 0x1B);
+        auto dchg = _mm_shuffle_epi32(state1, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data()),
+                         _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data() + 4),
+                         _mm_alignr_epi8(dchg, feba, 8));
+    }
+#endif
+
+    struct Sha1_Traits {
+        using State = std::array<std::uint32_t, 5>;
+        static constexpr std::size_t digest_size = 20;
+        static constexpr State initial = {
+            0x67452301U, 0xEFCDAB89U, 0x98BADCFEU, 0x10325476U, 0xC3D2E1F0U};
+
+        static void compress(State &state, unsigned char const *blocks, std::size_t count) noexcept
+        {
+#if defined(__SHA__) && defined(__SSE4_1__)
+            sha1_compress_shani(state, blocks, count, std::make_integer_sequence<int, 20>{});
+#else
+            sha1_compress_scalar(state, blocks, count);
+#endif
+        }
+    };
+
+    struct Sha256_Traits {
+        using State = std::array<std::uint32_t, 8>;
+        static constexpr std::size_t digest_size = 32;
+        static constexpr State initial = {0x6A09E667U,
+                                          0xBB67AE85U,
+                                          0x3C6EF372U,
+                                          0xA54FF53AU,
+                                          0x510E527FU,
+                                          0x9B05688CU,
+                                          0x1F83D9ABU,
+                                          0x5BE0CD19U};
+
+        static void compress(State &state, unsigned char const *blocks, std::size_t count) noexcept
+        {
+#if defined(__SHA__) && defined(__SSE4_1__)
+            sha256_compress_shani(state, blocks, count, std::make_integer_sequence<int, 16>{});
+#else
+            sha256_compress_scalar(state, blocks, count);
+#endif
+        }
+    };
+
+    /// Merkle-Damgard hash with 64-byte blocks and big-endian lengths and words.
+    template <typename Traits>
+    class Block_Hasher {
+       private:
+        typename Traits::State state_ = Traits::initial;
+        std::array<unsigned char, 64> buffer_{};
+        std::size_t buffered_ = 0;
+        std::uint64_t length_ = 0;
+
+       public:
+        using Digest = std::array<std::uint8_t, Traits::digest_size>;
+
+        void update(std::string_view data) noexcept
+        {
+            auto const *bytes = reinterpret_cast<unsigned char const *>(data.data());
+            auto size = data.size();
+            length_ += size;
+            if (buffered_ > 0) {
+                auto count = std::min(size, buffer_.size() - buffered_);
+                std::memcpy(buffer_.data() + buffered_, bytes, count);
+                buffered_ += count;
+                bytes += count;
+                size -= count;
+                if (buffered_ < buffer_.size()) {
+                    return;
+                }
+                Traits::compress(state_, buffer_.data(), 1);
+                buffered_ = 0;
+            }
+            Traits::compress(state_, bytes, size / 64);
+            std::memcpy(buffer_.data(), bytes + size / 64 * 64, size % 64);
+            buffered_ = size % 64;
+        }
+
+        [[nodiscard]] auto finish() noexcept -> Digest
+        {
+            auto bits = length_ * 8;
+            buffer_[buffered_++] = 0x80;
+            if (buffered_ > 56) {
+                std::memset(buffer_.data() + buffered_, 0, 64 - buffered_);
+                Traits::compress(state_, buffer_.data(), 1);
+                buffered_ = 0;
+            }
+            std::memset(buffer_.data() + buffered_, 0, 56 - buffered_);
+            for (std::size_t idx = 0; idx < 8; ++idx) {
+                buffer_[56 + idx] = static_cast<unsigned char>(bits >> (56 - 8 * idx));
+            }
+            Traits::compress(state_, buffer_.data(), 1);
+            Digest digest{};
+            for (std::size_t idx = 0; idx < digest.size(); ++idx) {
+                digest[idx] = static_cast<std::uint8_t>(state_[idx / 4] >> (24 - 8 * (idx % 4)));
+            }
+            return digest;
+        }
+    };
+
+} // namespace detail
+
+/// SHA-1 (FIPS 180-4), using SHA-NI instructions when compiled for them.
+using Sha1 = detail::Block_Hasher<detail::Sha1_Traits>;
+/// SHA-256 (FIPS 180-4), using SHA-NI instructions when compiled for them.
+using Sha256 = detail::Block_Hasher<detail::Sha256_Traits>;
+
+/// Encodes `data` in base 32 (RFC 4648), with padding, as used by WARC digests.
+[[nodiscard]] inline auto base32_encode(std::string_view data) -> std::string
+{
+    constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+    std::string output;
+    std::uint32_t buffer = 0;
+    unsigned bits = 0;
+    for (char c : data) {
+        buffer = (buffer << 8U) | static_cast<unsigned char>(c);
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            output += alphabet[(buffer >> bits) & 0x1FU];
+        }
+    }
+    if (bits > 0) {
+        output += alphabet[(buffer << (5 - bits)) & 0x1FU];
+    }
+    while (output.size() % 8 != 0) {
+        output += '=';
+    }
+    return output;
+}
+
+/**
+ * Decodes a digest value in base 32 (case-insensitive, with optional
+ * padding) or, if it has twice as many characters as `size`, in hex.
+ * Returns `std::nullopt` unless it decodes to exactly `size` bytes.
+ */
+[[nodiscard]] inline auto decode_digest(std::string_view value, std::size_t size)
+    -> std::optional<std::string>
+{
+    std::string output;
+    auto hex_digit = [](char c) -> int {
+        c = detail::to_lower(c);
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    };
+    if (value.size() == 2 * size) {
+        for (std::size_t idx = 0; idx < value.size(); idx += 2) {
+            auto high = hex_digit(value[idx]);
+            auto low = hex_digit(value[idx + 1]);
+            if (high < 0 || low < 0) {
+                output.clear();
+                break;
+            }
+            output += static_cast<char>(high * 16 + low);
+        }
+        if (output.size() == size) {
+            return output;
+        }
+    }
+    while (not value.empty() && value.back() == '=') {
+        value.remove_suffix(1);
+    }
+    std::uint32_t buffer = 0;
+    unsigned bits = 0;
+    for (char c : value) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        std::uint32_t digit = 0;
+        if (c >= 'A' && c <= 'Z') {
+            digit = static_cast<std::uint32_t>(c - 'A');
+        } else if (c >= '2' && c <= '7') {
+            digit = static_cast<std::uint32_t>(c - '2' + 26);
+        } else {
+            return std::nullopt;
+        }
+        buffer = (buffer << 5U) | digit;
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            output += static_cast<char>((buffer >> bits) & 0xFFU);
+        }
+    }
+    if (output.size() != size) {
+        return std::nullopt;
+    }
+    return output;
+}
+
+enum class Digest_Status {
+    /// The record has no such digest field.
+    Missing,
+    Match,
+    Mismatch,
+    /// The algorithm is neither SHA-1 nor SHA-256, or the value cannot be decoded.
+    Unsupported
+};
+
+struct Digest_Check {
+    Digest_Status block = Digest_Status::Missing;
+    Digest_Status payload = Digest_Status::Missing;
+};
+
+/**
+ * Checks `data` against a digest field value `algorithm:value`, where the
+ * algorithm is `sha1` or `sha256` (case-insensitive).
+ */
+[[nodiscard]] inline auto check_digest(std::string_view digest, std::string_view data)
+    -> Digest_Status
+{
+    auto colon = digest.find(':');
+    if (colon == std::string_view::npos) {
+        return Digest_Status::Unsupported;
+    }
+    auto algorithm = digest.substr(0, colon);
+    auto value = detail::trim_view(digest.substr(colon + 1));
+    auto compare = [&](auto hasher) {
+        hasher.update(data);
+        auto computed = hasher.finish();
+        auto expected = decode_digest(value, computed.size());
+        if (not expected) {
+            return Digest_Status::Unsupported;
+        }
+        return std::memcmp(expected->data(), computed.data(), computed.size()) == 0
+                   ? Digest_Status::Match
+                   : Digest_Status::Mismatch;
+    };
+    if (detail::iequals(algorithm, "sha1")) {
+        return compare(Sha1{});
+    }
+    if (detail::iequals(algorithm, "sha256") || detail::iequals(algorithm, "sha-256")) {
+        return compare(Sha256{});
+    }
+    return Digest_Status::Unsupported;
+}
+
+/**
+ * Returns the payload of a record block: for `application/http` blocks, the
+ * bytes after the HTTP headers (still transfer-encoded, as digested by
+ * crawlers); otherwise the whole block.
+ */
+[[nodiscard]] inline auto record_payload(std::string_view block, std::string_view content_type)
+    -> std::string_view
+{
+    if (content_type.find("application/http") == std::string_view::npos) {
+        return block;
+    }
+    for (auto pos = block.find('\n'); pos != std::string_view::npos;
+         pos = block.find('\n', pos + 1)) {
+        auto next = pos + 1;
+        if (next < block.size() && block[next] == '\r') {
+            ++next;
+        }
+        if (next < block.size() && block[next] == '\n') {
+            return block.substr(next + 1);
+        }
+    }
+    return block.substr(block.size());
+}
+
+/**
+ * Verifies the `WARC-Block-Digest` and `WARC-Payload-Digest` fields of a
+ * `Record` or `Record_View` against its content. The record must have been
+ * read with these fields and `Content-Type`.
+ */
+template <typename Record_Type>
+[[nodiscard]] auto verify_digests(Record_Type const &record) -> Digest_Check
+{
+    Digest_Check check;
+    auto const &fields = record.fields();
+    std::string_view content = record.content();
+    if (auto const *digest = fields.get(Field::Warc_Block_Digest); digest != nullptr) {
+        check.block = check_digest(*digest, content);
+    }
+    if (auto const *digest = fields.get(Field::Warc_Payload_Digest); digest != nullptr) {
+        auto const *content_type = fields.get(Field::Content_Type);
+        auto type = content_type != nullptr ? std::string_view(*content_type) : std::string_view{};
+        check.payload = check_digest(*digest, record_payload(content, type));
+    }
+    return check;
+}
+
+} // namespace warcpp
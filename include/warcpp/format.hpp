@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+namespace detail {
+
+    /**
+     * Appends `input` to `output`, calling `escape(c, output)` instead of
+     * appending each character `c` that is one of `Cs`. Blocks of `simd_width`
+     * characters are checked at once, and runs of characters that need no
+     * escaping are copied whole.
+     */
+    template <char... Cs, typename Escape>
+    void escape_into(std::string_view input, std::string &output, Escape &&escape)
+    {
+        output.reserve(output.size() + input.size());
+        char const *data = input.data();
+        std::size_t size = input.size();
+        std::size_t run_start = 0;
+        auto visit = [&](std::size_t pos) {
+            output.append(data + run_start, pos - run_start);
+            escape(data[pos], output);
+            run_start = pos + 1;
+        };
+        std::size_t pos = 0;
+        for (; simd_width > 0 && pos + simd_width <= size; pos += simd_width) {
+            for (auto mask = match_any<Cs...>(data + pos); mask != 0; mask &= mask - 1) {
+                visit(pos + count_trailing_zeros(mask));
+            }
+        }
+        for (; pos < size; ++pos) {
+            if (((data[pos] == Cs) || ...)) {
+                visit(pos);
+            }
+        }
+        output.append(data + run_start, size - run_start);
+    }
+
+    [[nodiscard]] constexpr auto hex_digit(unsigned value) noexcept -> char
+    {
+        return "0123456789ABCDEF"[value & 0xFU];
+    }
+
+    /// Appends `\uXXXX` for a character below U+0100.
+    inline void append_unicode_escape(char c, std::string &output)
+    {
+        auto value = static_cast<unsigned char>(c);
+        char escaped[] = {'\\', 'u', '0', '0', hex_digit(value >> 4U), hex_digit(value)};
+        output.append(escaped, sizeof(escaped));
+    }
+
+    /**
+     * Returns the length of the well-formed UTF-8 sequence (RFC 3629) starting
+     * at `data`, or 0 if there is none; `size` is the number of bytes available.
+     */
+    [[nodiscard]] inline auto utf8_sequence_length(char const *data, std::size_t size) noexcept
+        -> std::size_t
+    {
+        auto byte = [&](std::size_t idx) { return static_cast<unsigned char>(data[idx]); };
+        auto continuation = [&](std::size_t idx) {
+            return idx < size && (byte(idx) & 0xC0U) == 0x80U;
+        };
+        auto lead = byte(0);
+        if (lead < 0x80U) {
+            return 1;
+        }
+        if (lead < 0xC2U) {
+            return 0;
+        }
+        if (lead < 0xE0U) {
+            return continuation(1) ? 2 : 0;
+        }
+        if (lead < 0xF0U) {
+            if (not continuation(1) || not continuation(2)) {
+                return 0;
+            }
+            // Reject overlong encodings and surrogates.
+            bool valid = (lead != 0xE0U || byte(1) >= 0xA0U) && (lead != 0xEDU || byte(1) < 0xA0U);
+            return valid ? 3 : 0;
+        }
+        if (lead < 0xF5U) {
+            if (not continuation(1) || not continuation(2) || not continuation(3)) {
+                return 0;
+            }
+            // Reject overlong encodings and code points above U+10FFFF.
+            bool valid = (lead != 0xF0U || byte(1) >= 0x90U) && (lead != 0xF4U || byte(1) < 0x90U);
+            return valid ? 4 : 0;
+        }
+        return 0;
+    }
+
+    [[nodiscard]] inline auto is_json_special(char c) noexcept -> bool
+    {
+        auto byte = static_cast<unsigned char>(c);
+        return byte < 0x20U || byte >= 0x80U || c == '"' || c == '\\';
+    }
+
+} // namespace detail
+
+/**
+ * Appends `input` to `output` with new lines, tabs, and carriage returns
+ * replaced by `\u000A`, `\u0009`, and `\u000D`, so that it fits in a single
+ * TSV column.
+ */
+inline void escape_tsv(std::string_view input, std::string &output)
+{
+    detail::escape_into<'\n', '\t', '\r'>(input, output, detail::append_unicode_escape);
+}
+
+/**
+ * Appends `input` to `output` escaped as the contents of a JSON string
+ * (without the quotes). Well-formed UTF-8 is copied as is, and bytes that
+ * are not part of a well-formed sequence are replaced by U+FFFD, so that
+ * the output is valid UTF-8 whatever the encoding of `input`.
+ *
+ * Blocks of ASCII characters that need no escaping are skipped `simd_width`
+ * bytes at a time, and runs of them are copied whole.
+ */
+inline void escape_json(std::string_view input, std::string &output)
+{
+    output.reserve(output.size() + input.size());
+    char const *data = input.data();
+    std::size_t size = input.size();
+    std::size_t run_start = 0;
+    std::size_t pos = 0;
+    while (pos < size) {
+        if (detail::simd_width > 0 && pos + detail::simd_width <= size) {
+            auto mask = detail::match_any<'"', '\\'>(data + pos) |
+                        detail::match_control(data + pos) | detail::match_non_ascii(data + pos);
+            if (mask == 0) {
+                pos += detail::simd_width;
+                continue;
+            }
+            pos += detail::count_trailing_zeros(mask);
+        } else if (not detail::is_json_special(data[pos])) {
+            ++pos;
+            continue;
+        }
+        auto c = data[pos];
+        if (static_cast<unsigned char>(c) >= 0x80U) {
+            if (auto length = detail::utf8_sequence_length(data + pos, size - pos); length > 0) {
+                pos += length;
+                continue;
+            }
+        }
+        output.append(data + run_start, pos - run_start);
+        switch (c) {
+        case '"':
+            output += "\\\"";
+            break;
+        case '\\':
+            output += "\\\\";
+            break;
+        case '\n':
+            output += "\\n";
+            break;
+        case '\r':
+            output += "\\r";
+            break;
+        case '\t':
+            output += "\\t";
+            break;
+        case '\b':
+            output += "\\b";
+            break;
+        case '\f':
+            output += "\\f";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) >= 0x80U) {
+                output += "\xef\xbf\xbd";
+            } else {
+                detail::append_unicode_escape(c, output);
+            }
+        }
+        run_start = ++pos;
+    }
+    output.append(data + run_start, size - run_start);
+}
+
+} // namespace warcpp
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <optional>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+namespace detail {
+
+    constexpr std::size_t gzip_buffer_size = 1U << 16U;
+
+    [[nodiscard]] inline auto is_gzip_header(unsigned char const *data, std::size_t size) noexcept
+        -> bool
+    {
+        // ID1, ID2, CM = deflate, and no reserved flag bits set.
+        return size >= 4 && data[0] == 0x1f && data[1] == 0x8b && data[2] == 0x08 &&
+               (data[3] & 0xe0U) == 0;
+    }
+
+} // namespace detail
+
+/**
+ * Stream buffer decompressing a gzip file read from `source`.
+ *
+ * Multi-member files (such as `.warc.gz` with one member per record) are
+ * decompressed transparently as a single stream, but the buffer keeps track
+ * of member boundaries: a get area never spans two members, so the reader
+ * can tell whether it is at the beginning of a member and can discard the
+ * rest of the current one. Corrupted members are skipped by searching for
+ * the next gzip header. The inflate state and both buffers are allocated once
+ * and reused for all members.
+ */
+class Gzip_Streambuf : public std::streambuf {
+   private:
+    std::istream *source_;
+    z_stream stream_{};
+    std::vector<char> in_buffer_;
+    std::vector<char> out_buffer_;
+    std::uint64_t source_offset_ = 0;
+    std::uint64_t member_offset_ = 0;
+    bool member_ended_ = true;
+    bool fresh_member_ = false;
+    bool chunk_begins_member_ = false;
+
+    [[nodiscard]] auto next_in_offset() const noexcept -> std::uint64_t
+    {
+        return source_offset_ - stream_.avail_in;
+    }
+
+    /// Moves unconsumed input to the front of the buffer and fills the rest.
+    auto refill() -> std::size_t
+    {
+        auto *begin = reinterpret_cast<Bytef *>(in_buffer_.data());
+        if (stream_.avail_in > 0 && stream_.next_in != begin) {
+            std::memmove(begin, stream_.next_in, stream_.avail_in);
+        }
+        stream_.next_in = begin;
+        source_->read(in_buffer_.data() + stream_.avail_in,
+                      static_cast<std::streamsize>(in_buffer_.size() - stream_.avail_in));
+        auto count = static_cast<std::size_t>(source_->gcount());
+        stream_.avail_in += static_cast<uInt>(count);
+        source_offset_ += count;
+        return count;
+    }
+
+    /// Positions the input at the next gzip header, skipping any garbage.
+    auto start_member() -> bool
+    {
+        while (true) {
+            if (stream_.avail_in < 4 && refill() == 0 && stream_.avail_in < 4) {
+                return false;
+            }
+            auto *first = stream_.next_in;
+            auto *last = first + stream_.avail_in;
+            auto *magic = static_cast<Bytef *>(std::memchr(first, 0x1f, stream_.avail_in));
+            while (magic != nullptr && last - magic >= 4 &&
+                   not detail::is_gzip_header(magic, last - magic)) {
+                magic = static_cast<Bytef *>(std::memchr(magic + 1, 0x1f, last - magic - 1));
+            }
+            if (magic != nullptr && last - magic >= 4) {
+                stream_.avail_in -= static_cast<uInt>(magic - first);
+                stream_.next_in = magic;
+                break;
+            }
+            // Keep a possible partial header at the end of the buffer.
+            auto keep = magic != nullptr ? static_cast<uInt>(last - magic) : 0U;
+            stream_.next_in = last - keep;
+            stream_.avail_in = keep;
+            if (refill() == 0) {
+                return false;
+            }
+        }
+        if (inflateReset(&stream_) != Z_OK) {
+            return false;
+        }
+        member_offset_ = next_in_offset();
+        member_ended_ = false;
+        fresh_member_ = true;
+        return true;
+    }
+
+    /// Inflates the current member into `out`; returns the number of bytes written.
+    auto inflate_into(char *out, std::size_t size) -> std::size_t
+    {
+        stream_.next_out = reinterpret_cast<Bytef *>(out);
+        stream_.avail_out = static_cast<uInt>(size);
+        while (stream_.avail_out > 0 && not member_ended_) {
+            if (stream_.avail_in == 0 && refill() == 0) {
+                member_ended_ = true; // Truncated member.
+                break;
+            }
+            auto status = inflate(&stream_, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                member_ended_ = true;
+            } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                // Corrupted data: the rest of the member is lost, resume at the next header.
+                member_ended_ = true;
+                if (stream_.avail_in > 0) {
+                    stream_.next_in += 1;
+                    stream_.avail_in -= 1;
+                }
+            }
+        }
+        return size - stream_.avail_out;
+    }
+
+   protected:
+    auto underflow() -> int_type override
+    {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        std::size_t count = 0;
+        while (count == 0) {
+            if (member_ended_ && not start_member()) {
+                setg(out_buffer_.data(), out_buffer_.data(), out_buffer_.data());
+                return traits_type::eof();
+            }
+            chunk_begins_member_ = fresh_member_;
+            fresh_member_ = false;
+            count = inflate_into(out_buffer_.data(), out_buffer_.size());
+        }
+        setg(out_buffer_.data(), out_buffer_.data(), out_buffer_.data() + count);
+        return traits_type::to_int_type(*gptr());
+    }
+
+   public:
+    explicit Gzip_Streambuf(std::istream &source,
+                            std::size_t buffer_size = detail::gzip_buffer_size)
+        : source_(&source), in_buffer_(buffer_size), out_buffer_(buffer_size)
+    {
+        // 16 + MAX_WBITS: expect gzip wrapper
+        if (inflateInit2(&stream_, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("could not initialize zlib stream");
+        }
+        setg(out_buffer_.data(), out_buffer_.data(), out_buffer_.data());
+    }
+    Gzip_Streambuf(Gzip_Streambuf const &) = delete;
+    Gzip_Streambuf &operator=(Gzip_Streambuf const &) = delete;
+    ~Gzip_Streambuf() override { inflateEnd(&stream_); }
+
+    /// Compressed offset of the member containing the next unread byte.
+    [[nodiscard]] auto member_offset() const noexcept -> std::uint64_t { return member_offset_; }
+
+    /// Whether no byte of the current member has been consumed yet.
+    [[nodiscard]] auto at_member_start() const noexcept -> bool
+    {
+        if (gptr() == egptr()) {
+            return member_ended_;
+        }
+        return chunk_begins_member_ && gptr() == eback();
+    }
+
+    /// Discards the unread remainder of the current member.
+    void skip_member()
+    {
+        setg(out_buffer_.data(), out_buffer_.data(), out_buffer_.data());
+        while (not member_ended_) {
+            inflate_into(out_buffer_.data(), out_buffer_.size());
+        }
+    }
+};
+
+/**
+ * Input stream decompressing a gzip (possibly multi-member) source.
+ *
+ * It can be passed to any function reading from a `std::istream`.
+ */
+class Gzip_Istream : public std::istream {
+   private:
+    Gzip_Streambuf buffer_;
+
+   public:
+    explicit Gzip_Istream(std::istream &source, std::size_t buffer_size = detail::gzip_buffer_size)
+        : std::istream(nullptr), buffer_(source, buffer_size)
+    {
+        rdbuf(&buffer_);
+    }
+
+    [[nodiscard]] auto member_offset() const noexcept -> std::uint64_t
+    {
+        return buffer_.member_offset();
+    }
+    [[nodiscard]] auto at_member_start() const noexcept -> bool
+    {
+        return buffer_.at_member_start();
+    }
+    void skip_member()
+    {
+        clear();
+        buffer_.skip_member();
+    }
+};
+
+/**
+ * Inflates single gzip members held in memory.
+ *
+ * The inflate state and the output buffer are reused between members, so
+ * once the buffer has grown to the largest member, no more allocations
+ * are done. An inflater is not thread-safe; use one per thread.
+ */
+class Member_Inflater {
+   private:
+    z_stream stream_{};
+    std::string output_;
+    std::size_t size_ = 0;
+
+   public:
+    Member_Inflater()
+    {
+        if (inflateInit2(&stream_, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("could not initialize zlib stream");
+        }
+    }
+    Member_Inflater(Member_Inflater const &) = delete;
+    Member_Inflater &operator=(Member_Inflater const &) = delete;
+    ~Member_Inflater() { inflateEnd(&stream_); }
+
+    /**
+     * Inflates the member starting at the beginning of `input`.
+     *
+     * Returns the compressed size of the member, or `std::nullopt` if `input`
+     * does not start with a valid and complete member.
+     */
+    [[nodiscard]] auto inflate(std::string_view input) -> std::optional<std::size_t>
+    {
+        size_ = 0;
+        if (inflateReset(&stream_) != Z_OK) {
+            return std::nullopt;
+        }
+        if (output_.empty()) {
+            output_.resize(detail::gzip_buffer_size);
+        }
+        auto *first = reinterpret_cast<Bytef const *>(input.data());
+        std::size_t consumed = 0;
+        while (true) {
+            if (size_ == output_.size()) {
+                output_.resize(output_.size() * 2);
+            }
+            auto in_chunk = std::min<std::size_t>(input.size() - consumed, UINT_MAX);
+            auto out_chunk = std::min<std::size_t>(output_.size() - size_, UINT_MAX);
+            stream_.next_in = const_cast<Bytef *>(first + consumed);
+            stream_.avail_in = static_cast<uInt>(in_chunk);
+            stream_.next_out = reinterpret_cast<Bytef *>(&output_[size_]);
+            stream_.avail_out = static_cast<uInt>(out_chunk);
+            auto status = ::inflate(&stream_, Z_NO_FLUSH);
+            consumed += in_chunk - stream_.avail_in;
+            size_ += out_chunk - stream_.avail_out;
+            if (status == Z_STREAM_END) {
+                return consumed;
+            }
+            if (status == Z_BUF_ERROR && consumed == input.size()) {
+                return std::nullopt; // Truncated member.
+            }
+            if (status != Z_OK && status != Z_BUF_ERROR) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    /// Decompressed data of the last inflated member.
+    [[nodiscard]] auto output() const noexcept -> std::string_view
+    {
+        return {output_.data(), size_};
+    }
+};
+
+/**
+ * Returns offsets of all candidate gzip member headers in `data`.
+ *
+ * Candidates are only checked for a well-formed header, so a few of them
+ * may be false positives inside compressed data; these fail to inflate or
+ * start before the end of the preceding member.
+ */
+[[nodiscard]] inline auto find_gzip_members(std::string_view data) -> std::vector<std::uint64_t>
+{
+    std::vector<std::uint64_t> offsets;
+    auto const *first = reinterpret_cast<unsigned char const *>(data.data());
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        auto const *magic = static_cast<unsigned char const *>(
+            std::memchr(first + pos, 0x1f, data.size() - pos));
+        if (magic == nullptr) {
+            break;
+        }
+        pos = static_cast<std::size_t>(magic - first);
+        if (detail::is_gzip_header(magic, data.size() - pos)) {
+            offsets.push_back(pos);
+        }
+        ++pos;
+    }
+    return offsets;
+}
+
+/// Checks (without consuming) whether the stream starts with a gzip header.
+[[nodiscard]] inline auto is_gzip(std::istream &in) -> bool
+{
+    return in.peek() == 0x1f;
+}
+
+/**
+ * Same as `read_subsequent_record` but uses gzip members as synchronization
+ * points: if a record starting at a member boundary is invalid, the rest of
+ * the member is discarded, and the next call starts at the following member
+ * instead of scanning line by line. Records that do not start at a member
+ * boundary fall back to line scanning. Records rejected by `filter` are
+ * skipped without copying their content.
+ */
+[[nodiscard]] inline auto read_subsequent_record(Gzip_Istream &in,
+                                                  Record &record,
+                                                  Record_Filter const &filter,
+                                                  Projection const &projection = {})
+    -> std::optional<Error>
+{
+    auto extended = filter.extend(projection);
+    while (true) {
+        bool member_start = in.at_member_start();
+        auto error = detail::read_header(in, record, extended, not member_start);
+        if (not error) {
+            if (not filter(record)) {
+                if (not detail::skip_bytes(in, record.content_length())) {
+                    return Error(Incomplete_Record{});
+                }
+                while (std::isspace(in.peek())) { in.ignore(1); }
+                continue;
+            }
+            error = detail::read_content(in, record);
+        }
+        if (error && member_start && not in.eof()) {
+            in.skip_member();
+        }
+        return error;
+    }
+}
+
+[[nodiscard]] inline auto read_subsequent_record(Gzip_Istream &in,
+                                                  Record &record,
+                                                  Projection const &projection = {})
+    -> std::optional<Error>
+{
+    return read_subsequent_record(in, record, Record_Filter{}, projection);
+}
+
+[[nodiscard]] inline auto read_subsequent_record(Gzip_Istream &in) -> Result
+{
+    Record record;
+    if (auto error = read_subsequent_record(in, record); error) {
+        return Result(std::move(*error));
+    }
+    return Result(std::move(record));
+}
+
+namespace detail {
+
+    /// Buffers of `read_record_at`, one set per thread.
+    struct Read_At_Buffers {
+        std::string input;
+        Member_Inflater inflater;
+    };
+
+    [[nodiscard]] inline auto read_at_buffers() -> Read_At_Buffers &
+    {
+        thread_local Read_At_Buffers buffers;
+        return buffers;
+    }
+
+    /// Reads `length` bytes at `offset` of `fd` into `output`; returns `false` if there are fewer.
+    [[nodiscard]] inline auto pread_exact(int fd,
+                                          std::uint64_t offset,
+                                          std::uint64_t length,
+                                          std::string &output) -> bool
+    {
+        output.resize(length);
+        std::size_t done = 0;
+        while (done < length) {
+            auto count =
+                ::pread(fd, &output[done], length - done, static_cast<off_t>(offset + done));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            done += static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+
+} // namespace detail
+
+/**
+ * Reads the record stored in the `length` bytes at `offset` of the file
+ * descriptor `fd`, e.g., a location from an index. If these bytes are a gzip
+ * member, it is inflated first; otherwise they are parsed as they are.
+ *
+ * The bytes are read with a single `pread`, which does not move the file
+ * offset, into buffers owned by the calling thread, so any number of threads
+ * can read from the same descriptor. `record` views these buffers and is
+ * valid until the next call on the same thread.
+ */
+[[nodiscard]] inline auto read_record_at(int fd,
+                                         std::uint64_t offset,
+                                         std::uint64_t length,
+                                         Record_View &record,
+                                         Projection const &projection = {})
+    -> std::optional<Error>
+{
+    auto &buffers = detail::read_at_buffers();
+    if (not detail::pread_exact(fd, offset, length, buffers.input)) {
+        return Error(Incomplete_Record{});
+    }
+    std::string_view in = buffers.input;
+    if (detail::is_gzip_header(reinterpret_cast<unsigned char const *>(in.data()), in.size())) {
+        if (not buffers.inflater.inflate(in)) {
+            return Error(Incomplete_Record{});
+        }
+        in = buffers.inflater.output();
+    }
+    return read_subsequent_record(in, record, projection);
+}
+
+/// Same as `read_record_at(int, std::uint64_t, std::uint64_t, Record_View&)` but copies the record.
+[[nodiscard]] inline auto read_record_at(int fd,
+                                         std::uint64_t offset,
+                                         std::uint64_t length,
+                                         Record &record,
+                                         Projection const &projection = {})
+    -> std::optional<Error>
+{
+    Record_View view;
+    if (auto error = read_record_at(fd, offset, length, view, projection); error) {
+        return error;
+    }
+    record = Record(view);
+    return std::nullopt;
+}
+
+} // namespace warcpp
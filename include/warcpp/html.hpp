@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+namespace detail {
+
+    struct Html_Entity {
+        std::string_view name;
+        std::string_view text;
+    };
+
+    /// Named entities decoded by `html_to_text`; others are kept as they are.
+    constexpr std::array<Html_Entity, 22> html_entities = {{
+        {"amp", "&"},
+        {"lt", "<"},
+        {"gt", ">"},
+        {"quot", "\""},
+        {"apos", "'"},
+        {"nbsp", " "},
+        {"copy", "\xc2\xa9"},
+        {"reg", "\xc2\xae"},
+        {"trade", "\xe2\x84\xa2"},
+        {"laquo", "\xc2\xab"},
+        {"raquo", "\xc2\xbb"},
+        {"middot", "\xc2\xb7"},
+        {"ndash", "\xe2\x80\x93"},
+        {"mdash", "\xe2\x80\x94"},
+        {"lsquo", "\xe2\x80\x98"},
+        {"rsquo", "\xe2\x80\x99"},
+        {"ldquo", "\xe2\x80\x9c"},
+        {"rdquo", "\xe2\x80\x9d"},
+        {"bull", "\xe2\x80\xa2"},
+        {"hellip", "\xe2\x80\xa6"},
+        {"euro", "\xe2\x82\xac"},
+        {"eacute", "\xc3\xa9"},
+    }};
+
+    /// Inline elements, which do not separate words.
+    constexpr std::array<std::string_view, 14> inline_tags = {
+        "a",
+        "abbr",
+        "b",
+        "code",
+        "em",
+        "font",
+        "i",
+        "mark",
+        "small",
+        "span",
+        "strong",
+        "sub",
+        "sup",
+        "u"};
+
+    [[nodiscard]] inline auto is_ascii_alpha(char c) noexcept -> bool
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    [[nodiscard]] inline auto is_html_space(char c) noexcept -> bool
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f';
+    }
+
+    /// Appends the UTF-8 encoding of `code_point`, or U+FFFD if it is not a valid scalar value.
+    inline void append_utf8(std::uint32_t code_point, std::string &output)
+    {
+        if (code_point == 0 || code_point > 0x10FFFFU ||
+            (code_point >= 0xD800U && code_point <= 0xDFFFU)) {
+            code_point = 0xFFFDU;
+        }
+        if (code_point < 0x80U) {
+            output += static_cast<char>(code_point);
+        } else if (code_point < 0x800U) {
+            output += static_cast<char>(0xC0U | (code_point >> 6U));
+            output += static_cast<char>(0x80U | (code_point & 0x3FU));
+        } else if (code_point < 0x10000U) {
+            output += static_cast<char>(0xE0U | (code_point >> 12U));
+            output += static_cast<char>(0x80U | ((code_point >> 6U) & 0x3FU));
+            output += static_cast<char>(0x80U | (code_point & 0x3FU));
+        } else {
+            output += static_cast<char>(0xF0U | (code_point >> 18U));
+            output += static_cast<char>(0x80U | ((code_point >> 12U) & 0x3FU));
+            output += static_cast<char>(0x80U | ((code_point >> 6U) & 0x3FU));
+            output += static_cast<char>(0x80U | (code_point & 0x3FU));
+        }
+    }
+
+    /**
+     * Decodes the entity starting with the `&` at the beginning of `input`
+     * into `output`; returns its length, or 0 if it is not a known entity.
+     */
+    [[nodiscard]] inline auto decode_entity(std::string_view input, std::string &output)
+        -> std::size_t
+    {
+        auto end = input.substr(0, 12).find(';');
+        if (end == std::string_view::npos || end < 2) {
+            return 0;
+        }
+        auto name = input.substr(1, end - 1);
+        if (name[0] != '#') {
+            for (auto const &entity : html_entities) {
+                if (entity.name == name) {
+                    output += entity.text;
+                    return end + 1;
+                }
+            }
+            return 0;
+        }
+        bool hex = name.size() > 1 && (name[1] == 'x' || name[1] == 'X');
+        auto digits = name.substr(hex ? 2 : 1);
+        if (digits.empty()) {
+            return 0;
+        }
+        std::uint32_t code_point = 0;
+        for (char c : digits) {
+            std::uint32_t digit = 0;
+            if (c >= '0' && c <= '9') {
+                digit = static_cast<std::uint32_t>(c - '0');
+            } else if (hex && to_lower(c) >= 'a' && to_lower(c) <= 'f') {
+                digit = static_cast<std::uint32_t>(to_lower(c) - 'a' + 10);
+            } else {
+                return 0;
+            }
+            code_point = code_point * (hex ? 16 : 10) + digit;
+        }
+        append_utf8(code_point, output);
+        return end + 1;
+    }
+
+    /// Finds `</name` (case-insensitively) in `input` starting at `pos`.
+    [[nodiscard]] inline auto find_closing_tag(std::string_view input,
+                                               std::size_t pos,
+                                               std::string_view name) noexcept -> std::size_t
+    {
+        while ((pos = input.find("</", pos)) != std::string_view::npos) {
+            if (iequals(input.substr(pos + 2, name.size()), name)) {
+                return pos;
+            }
+            pos += 2;
+        }
+        return input.size();
+    }
+
+} // namespace detail
+
+/**
+ * Appends the text of the HTML document `html` to `output`.
+ *
+ * Tags and comments are removed, and the contents of `script` and `style`
+ * elements are skipped. Common named entities and numeric character
+ * references are decoded. Runs of whitespace, and tags other than inline
+ * ones such as `<b>`, become a single space, and there is no space at the
+ * beginning or the end of the text.
+ *
+ * Markup, entities, and whitespace are located `simd_width` bytes at a time,
+ * and the text between them is copied whole. The parser is lenient rather
+ * than conforming: it never fails, and `>` in attribute values ends a tag.
+ */
+inline void html_to_text(std::string_view html, std::string &output)
+{
+    auto begin = output.size();
+    char const *data = html.data();
+    std::size_t size = html.size();
+    std::size_t run_start = 0;
+    std::size_t pos = 0;
+    auto flush = [&] { output.append(data + run_start, pos - run_start); };
+    auto append_space = [&] {
+        if (output.size() > begin && output.back() != ' ') {
+            output += ' ';
+        }
+    };
+    while (pos < size) {
+        if (detail::simd_width > 0 && pos + detail::simd_width <= size) {
+            auto mask = detail::match_any<'<', '&', ' ', '\n', '\t', '\r', '\f'>(data + pos);
+            if (mask == 0) {
+                pos += detail::simd_width;
+                continue;
+            }
+            pos += detail::count_trailing_zeros(mask);
+        } else if (data[pos] != '<' && data[pos] != '&' && not detail::is_html_space(data[pos])) {
+            ++pos;
+            continue;
+        }
+        auto c = data[pos];
+        bool after_text = pos > run_start || (output.size() > begin && output.back() != ' ');
+        if (c == ' ' && after_text && pos + 1 < size && not detail::is_html_space(data[pos + 1])) {
+            // A single space between words is copied with the rest of the run.
+            ++pos;
+            continue;
+        }
+        if (detail::is_html_space(c)) {
+            flush();
+            while (pos < size && detail::is_html_space(data[pos])) {
+                ++pos;
+            }
+            append_space();
+            run_start = pos;
+            continue;
+        }
+        if (c == '&') {
+            flush();
+            auto length = detail::decode_entity(html.substr(pos), output);
+            if (length == 0) {
+                run_start = pos++;
+                continue;
+            }
+            if (detail::is_html_space(output.back())) {
+                // `&nbsp;` or a character reference to whitespace.
+                output.pop_back();
+                append_space();
+            }
+            pos += length;
+            run_start = pos;
+            continue;
+        }
+        // c == '<'
+        auto next = pos + 1 < size ? data[pos + 1] : '\0';
+        bool closing = next == '/';
+        auto name_begin = pos + (closing ? 2 : 1);
+        if (not closing && next != '!' && next != '?' && not detail::is_ascii_alpha(next)) {
+            ++pos; // A literal `<`.
+            continue;
+        }
+        flush();
+        if (html.substr(pos, 4) == "<!--") {
+            auto end = html.find("-->", pos + 4);
+            pos = end == std::string_view::npos ? size : end + 3;
+            run_start = pos;
+            continue;
+        }
+        auto name_end = name_begin;
+        while (name_end < size &&
+               (detail::is_ascii_alpha(data[name_end]) ||
+                (data[name_end] >= '0' && data[name_end] <= '9'))) {
+            ++name_end;
+        }
+        auto name = html.substr(name_begin, name_end - name_begin);
+        auto *tag_end = static_cast<char const *>(std::memchr(data + pos, '>', size - pos));
+        pos = tag_end == nullptr ? size : static_cast<std::size_t>(tag_end - data) + 1;
+        if (not closing && (detail::iequals(name, "script") || detail::iequals(name, "style"))) {
+            pos = detail::find_closing_tag(html, pos, name);
+            tag_end = static_cast<char const *>(std::memchr(data + pos, '>', size - pos));
+            pos = tag_end == nullptr ? size : static_cast<std::size_t>(tag_end - data) + 1;
+        }
+        bool is_inline = false;
+        for (auto tag : detail::inline_tags) {
+            is_inline = is_inline || detail::iequals(name, tag);
+        }
+        if (not is_inline) {
+            append_space();
+        }
+        run_start = pos;
+    }
+    flush();
+    if (output.size() > begin && output.back() == ' ') {
+        output.pop_back();
+    }
+}
+
+} // namespace warcpp
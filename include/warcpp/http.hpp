@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <zlib.h>
+#if defined(WARCPP_BROTLI)
+#include <brotli/decode.h>
+#endif
+
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+/// Common HTTP response headers, looked up like `Field`s.
+enum class Http_Header : std::uint8_t {
+    Content_Type,
+    Content_Length,
+    Content_Encoding,
+    Transfer_Encoding,
+    Content_Language,
+    Content_Location,
+    Content_Disposition,
+    Date,
+    Last_Modified,
+    Expires,
+    Cache_Control,
+    Etag,
+    Location,
+    Server,
+    Set_Cookie,
+    Connection,
+    Vary,
+    Link,
+    Refresh,
+    X_Robots_Tag,
+    Unknown
+};
+
+constexpr std::size_t http_header_count = static_cast<std::size_t>(Http_Header::Unknown);
+
+namespace detail {
+
+    constexpr std::array<std::string_view, http_header_count> http_header_names = {
+        "content-type",
+        "content-length",
+        "content-encoding",
+        "transfer-encoding",
+        "content-language",
+        "content-location",
+        "content-disposition",
+        "date",
+        "last-modified",
+        "expires",
+        "cache-control",
+        "etag",
+        "location",
+        "server",
+        "set-cookie",
+        "connection",
+        "vary",
+        "link",
+        "refresh",
+        "x-robots-tag"};
+
+    constexpr std::uint32_t http_header_seed = find_field_seed(http_header_names);
+
+    [[nodiscard]] constexpr auto make_http_header_table() noexcept
+        -> std::array<Http_Header, field_table_size>
+    {
+        std::array<Http_Header, field_table_size> table{};
+        for (auto &id : table) {
+            id = Http_Header::Unknown;
+        }
+        for (std::size_t idx = 0; idx < http_header_count; ++idx) {
+            table[field_hash(http_header_names[idx], http_header_seed)] =
+                static_cast<Http_Header>(idx);
+        }
+        return table;
+    }
+
+    constexpr std::array<Http_Header, field_table_size> http_header_table =
+        make_http_header_table();
+
+    /// Removes a trailing `\r` left by `next_line`.
+    [[nodiscard]] constexpr auto strip_cr(std::string_view line) noexcept -> std::string_view
+    {
+        return not line.empty() && line.back() == '\r' ? line.substr(0, line.size() - 1) : line;
+    }
+
+} // namespace detail
+
+/// Canonical (lowercase) name of a standard header.
+[[nodiscard]] constexpr auto http_header_name(Http_Header id) noexcept -> std::string_view
+{
+    return id == Http_Header::Unknown ? std::string_view{}
+                                      : detail::http_header_names[static_cast<std::size_t>(id)];
+}
+
+/// Maps a header name, regardless of its case, to its ID, or to `Http_Header::Unknown`.
+[[nodiscard]] constexpr auto http_header_id(std::string_view name) noexcept -> Http_Header
+{
+    auto id = detail::http_header_table[detail::field_hash(name, detail::http_header_seed)];
+    return id != Http_Header::Unknown && detail::iequals_lower(name, http_header_name(id))
+               ? id
+               : Http_Header::Unknown;
+}
+
+static_assert(http_header_id("Content-Type") == Http_Header::Content_Type);
+static_assert(http_header_id("X-Custom") == Http_Header::Unknown);
+
+/**
+ * HTTP response parsed from a record's content, usually the block of a
+ * `response` record, without copying.
+ *
+ * All views point into the parsed message. Standard headers are stored in
+ * slots indexed by `Http_Header` when parsing, so `get` is a lookup; other
+ * headers are found by scanning the header block. If a header is repeated,
+ * the first occurrence is returned. Values are trimmed; continuation lines
+ * are kept inside the value as they are.
+ */
+class Http_View {
+   private:
+    std::string_view version_;
+    unsigned status_ = 0;
+    std::string_view reason_;
+    std::array<std::string_view, http_header_count> values_{};
+    std::uint32_t present_ = 0;
+    std::string_view headers_;
+    std::string_view body_;
+
+    [[nodiscard]] static constexpr auto bit(Http_Header id) noexcept -> std::uint32_t
+    {
+        return 1U << static_cast<std::uint32_t>(id);
+    }
+
+    /// Calls `fn(name, value)` for each header line in `headers`, including continuations.
+    template <typename Fn>
+    static void scan_headers(std::string_view headers, Fn &&fn)
+    {
+        std::string_view name;
+        char const *value_begin = nullptr;
+        char const *value_end = nullptr;
+        auto flush = [&] {
+            if (value_begin != nullptr) {
+                auto size = static_cast<std::size_t>(value_end - value_begin);
+                fn(name, detail::trim_view({value_begin, size}));
+            }
+        };
+        while (not headers.empty()) {
+            auto line = detail::strip_cr(detail::next_line(headers));
+            if (not line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+                if (value_begin != nullptr) {
+                    value_end = line.data() + line.size();
+                }
+                continue;
+            }
+            flush();
+            value_begin = nullptr;
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                continue;
+            }
+            name = detail::trim_view(line.substr(0, colon));
+            value_begin = line.data() + colon + 1;
+            value_end = line.data() + line.size();
+        }
+        flush();
+    }
+
+    friend auto read_http_response(std::string_view message, Http_View &response) -> bool;
+
+   public:
+    /// Protocol version, e.g., `HTTP/1.1`.
+    [[nodiscard]] auto version() const noexcept -> std::string_view { return version_; }
+    [[nodiscard]] auto status() const noexcept -> unsigned { return status_; }
+    [[nodiscard]] auto reason() const noexcept -> std::string_view { return reason_; }
+
+    [[nodiscard]] auto has(Http_Header id) const noexcept -> bool
+    {
+        return id != Http_Header::Unknown && (present_ & bit(id)) != 0;
+    }
+
+    [[nodiscard]] auto get(Http_Header id) const noexcept -> std::string_view const *
+    {
+        return has(id) ? &values_[static_cast<std::size_t>(id)] : nullptr;
+    }
+
+    /// Looks up a header by its name, case-insensitively.
+    [[nodiscard]] auto find(std::string_view name) const -> std::optional<std::string_view>
+    {
+        if (auto id = http_header_id(name); id != Http_Header::Unknown) {
+            if (auto const *value = get(id); value != nullptr) {
+                return *value;
+            }
+            return std::nullopt;
+        }
+        std::optional<std::string_view> found = std::nullopt;
+        scan_headers(headers_, [&](std::string_view header, std::string_view value) {
+            if (not found && detail::iequals(header, name)) {
+                found = value;
+            }
+        });
+        return found;
+    }
+
+    /// Calls `fn(name, value)` for every header, in order.
+    template <typename Fn>
+    void for_each(Fn &&fn) const
+    {
+        scan_headers(headers_, fn);
+    }
+
+    /// Entity body: everything after the empty line ending the headers.
+    [[nodiscard]] auto body() const noexcept -> std::string_view { return body_; }
+};
+
+/**
+ * Parses the status line and headers of an HTTP response at the beginning of
+ * `message`. Returns `false` if `message` does not start with a status line
+ * or the headers are not terminated by an empty line.
+ */
+[[nodiscard]] inline auto read_http_response(std::string_view message, Http_View &response)
+    -> bool
+{
+    response = Http_View{};
+    auto status_line = detail::strip_cr(detail::next_line(message));
+    auto space = status_line.find(' ');
+    auto version = status_line.substr(0, space);
+    auto rest =
+        space == std::string_view::npos ? std::string_view{} : status_line.substr(space + 1);
+    if (version.substr(0, 5) != "HTTP/" || rest.size() < 3) {
+        return false;
+    }
+    unsigned status = 0;
+    for (std::size_t idx = 0; idx < 3; ++idx) {
+        if (rest[idx] < '0' || rest[idx] > '9') {
+            return false;
+        }
+        status = status * 10 + static_cast<unsigned>(rest[idx] - '0');
+    }
+    if (rest.size() > 3 && rest[3] != ' ') {
+        return false;
+    }
+    response.version_ = version;
+    response.status_ = status;
+    response.reason_ = detail::trim_view(rest.substr(3));
+    char const *headers_begin = message.data();
+    while (true) {
+        if (message.empty()) {
+            return false;
+        }
+        auto line_begin = message.data();
+        if (detail::strip_cr(detail::next_line(message)).empty()) {
+            auto size = static_cast<std::size_t>(line_begin - headers_begin);
+            response.headers_ = {headers_begin, size};
+            break;
+        }
+    }
+    response.body_ = message;
+    Http_View::scan_headers(response.headers_, [&](std::string_view name, std::string_view value) {
+        auto id = http_header_id(name);
+        if (id != Http_Header::Unknown && not response.has(id)) {
+            response.values_[static_cast<std::size_t>(id)] = value;
+            response.present_ |= Http_View::bit(id);
+        }
+    });
+    return true;
+}
+
+/**
+ * Removes chunked transfer encoding from the `size` bytes at `data` in place
+ * (the payload is never longer than its framing) and returns the payload
+ * size. Chunk extensions and trailers are ignored, and a body truncated in
+ * the middle of a chunk keeps the bytes that are present. Returns
+ * `std::nullopt` if a chunk size line is malformed.
+ */
+[[nodiscard]] inline auto dechunk(char *data, std::size_t size) -> std::optional<std::size_t>
+{
+    std::size_t read = 0;
+    std::size_t written = 0;
+    while (read < size) {
+        std::uint64_t chunk_size = 0;
+        std::size_t digits = 0;
+        for (; read < size && std::isxdigit(static_cast<unsigned char>(data[read])); ++read) {
+            if (++digits > 15) {
+                return std::nullopt;
+            }
+            auto c = detail::to_lower(data[read]);
+            auto digit = c <= '9' ? c - '0' : c - 'a' + 10;
+            chunk_size = chunk_size * 16 + static_cast<std::uint64_t>(digit);
+        }
+        if (digits == 0) {
+            return std::nullopt;
+        }
+        auto *line_end = static_cast<char *>(std::memchr(data + read, '\n', size - read));
+        if (line_end == nullptr || chunk_size == 0) {
+            break;
+        }
+        read = static_cast<std::size_t>(line_end - data) + 1;
+        auto available = std::min<std::uint64_t>(chunk_size, size - read);
+        std::memmove(data + written, data + read, available);
+        written += available;
+        read += available;
+        if (read < size && data[read] == '\r') {
+            ++read;
+        }
+        if (read < size && data[read] == '\n') {
+            ++read;
+        }
+    }
+    return written;
+}
+
+/**
+ * Decodes HTTP entity bodies: removes chunked transfer encoding and inflates
+ * gzip, deflate (with or without the zlib wrapper), and, when built with
+ * `WARCPP_BROTLI`, brotli content encodings.
+ *
+ * Nothing is done until `decode` is called, so records that are filtered out
+ * cost nothing. Output is written to buffers owned by the decoder and reused
+ * by the next call; a decoder is not thread-safe, so use one per thread.
+ */
+class Http_Body_Decoder {
+   private:
+    z_stream stream_{};
+    std::string input_;
+    std::string output_;
+
+    /// Inflates `input` into `output_` with `window_bits`; keeps the output of truncated input.
+    [[nodiscard]] auto inflate(std::string_view input, int window_bits) -> bool
+    {
+        if (inflateReset2(&stream_, window_bits) != Z_OK) {
+            return false;
+        }
+        output_.resize(input.size() * 4 + 1024);
+        std::size_t consumed = 0;
+        std::size_t produced = 0;
+        while (true) {
+            if (produced == output_.size()) {
+                output_.resize(output_.size() * 2);
+            }
+            auto in_chunk = std::min<std::size_t>(input.size() - consumed, UINT_MAX);
+            auto out_chunk = std::min<std::size_t>(output_.size() - produced, UINT_MAX);
+            auto *next_in = input.data() + consumed;
+            stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(next_in));
+            stream_.avail_in = static_cast<uInt>(in_chunk);
+            stream_.next_out = reinterpret_cast<Bytef *>(&output_[produced]);
+            stream_.avail_out = static_cast<uInt>(out_chunk);
+            auto status = ::inflate(&stream_, Z_NO_FLUSH);
+            consumed += in_chunk - stream_.avail_in;
+            produced += out_chunk - stream_.avail_out;
+            bool truncated = status == Z_BUF_ERROR && consumed == input.size();
+            if (status == Z_STREAM_END || truncated) {
+                output_.resize(produced);
+                return true;
+            }
+            if (status != Z_OK && status != Z_BUF_ERROR) {
+                return false;
+            }
+        }
+    }
+
+#if defined(WARCPP_BROTLI)
+    [[nodiscard]] auto decompress_brotli(std::string_view input) -> bool
+    {
+        auto *state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        if (state == nullptr) {
+            return false;
+        }
+        output_.resize(input.size() * 4 + 1024);
+        auto const *next_in = reinterpret_cast<std::uint8_t const *>(input.data());
+        auto available_in = input.size();
+        std::size_t produced = 0;
+        auto result = BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+        while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) {
+            if (produced == output_.size()) {
+                output_.resize(output_.size() * 2);
+            }
+            auto *next_out = reinterpret_cast<std::uint8_t *>(&output_[produced]);
+            auto available_out = output_.size() - produced;
+            result = BrotliDecoderDecompressStream(
+                state, &available_in, &next_in, &available_out, &next_out, nullptr);
+            produced = output_.size() - available_out;
+        }
+        BrotliDecoderDestroyInstance(state);
+        output_.resize(produced);
+        return result != BROTLI_DECODER_RESULT_ERROR;
+    }
+#endif
+
+   public:
+    Http_Body_Decoder()
+    {
+        if (inflateInit2(&stream_, 16 + MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("could not initialize zlib stream");
+        }
+    }
+    Http_Body_Decoder(Http_Body_Decoder const &) = delete;
+    Http_Body_Decoder &operator=(Http_Body_Decoder const &) = delete;
+    ~Http_Body_Decoder() { inflateEnd(&stream_); }
+
+    /**
+     * Returns the decoded body of `response`: a view of `response.body()` if
+     * it is not encoded, or of a buffer of the decoder, valid until the next
+     * call. Returns `std::nullopt` for an unsupported or corrupted encoding.
+     *
+     * A body that is declared chunked but does not start with a chunk size
+     * line is assumed to have been stored dechunked already.
+     */
+    [[nodiscard]] auto decode(Http_View const &response) -> std::optional<std::string_view>
+    {
+        std::string_view body = response.body();
+        auto const *transfer_encoding = response.get(Http_Header::Transfer_Encoding);
+        if (transfer_encoding != nullptr &&
+            transfer_encoding->find("chunked") != std::string_view::npos) {
+            input_.assign(body.data(), body.size());
+            if (auto size = dechunk(&input_[0], input_.size()); size) {
+                body = std::string_view(input_.data(), *size);
+            }
+        }
+        auto const *content_encoding = response.get(Http_Header::Content_Encoding);
+        if (content_encoding == nullptr || content_encoding->empty() ||
+            detail::iequals(*content_encoding, "identity")) {
+            return body;
+        }
+        bool decoded = false;
+        if (detail::iequals(*content_encoding, "gzip") ||
+            detail::iequals(*content_encoding, "x-gzip")) {
+            decoded = inflate(body, 16 + MAX_WBITS);
+        } else if (detail::iequals(*content_encoding, "deflate")) {
+            decoded = inflate(body, MAX_WBITS) || inflate(body, -MAX_WBITS);
+#if defined(WARCPP_BROTLI)
+        } else if (detail::iequals(*content_encoding, "br")) {
+            decoded = decompress_brotli(body);
+#endif
+        }
+        if (not decoded) {
+            return std::nullopt;
+        }
+        return std::string_view(output_);
+    }
+};
+
+} // namespace warcpp
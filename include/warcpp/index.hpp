@@ -0,0 +1,303 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "gzip.hpp"
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+/*
+ * Record index format
+ * ===================
+ *
+ * An index maps keys (e.g., target URIs or record IDs) to the location of
+ * the record in a WARC file, like a CDX file. Entries are sorted by key, then
+ * by file and offset, and have a fixed size, so a memory-mapped index can be
+ * searched in place. All integers are unsigned 64-bit little-endian.
+ *
+ *     index := magic file_count (name_size name){file_count}
+ *              entry_count entry{entry_count} key_bytes
+ *     magic := "WARCIDX1"
+ *     entry := key_offset key_size file offset length
+ *
+ * `key_offset` is relative to the first key byte, `file` is the position
+ * of the file name in the header, and `offset` and `length` delimit the
+ * record in the file: for gzip files, the member holding the record.
+ */
+
+namespace detail {
+
+    constexpr std::string_view index_magic = "WARCIDX1";
+    constexpr std::size_t index_entry_size = 5 * 8;
+
+} // namespace detail
+
+/// Location of an indexed record.
+struct Index_Entry {
+    std::string_view key;
+    std::string_view file;
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
+/**
+ * Collects index entries and writes them sorted.
+ *
+ * Keys are held in memory until `write` is called, so very large collections
+ * are better indexed one file (or a few) at a time.
+ */
+class Index_Builder {
+   private:
+    struct Entry {
+        std::string key;
+        std::uint64_t file;
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+    std::vector<std::string> files_;
+    std::vector<Entry> entries_;
+
+   public:
+    /// Adds a file name to the index and returns its position.
+    auto add_file(std::string name) -> std::uint64_t
+    {
+        files_.push_back(std::move(name));
+        return files_.size() - 1;
+    }
+
+    void add(std::string_view key, std::uint64_t file, std::uint64_t offset, std::uint64_t length)
+    {
+        if (file >= files_.size()) {
+            throw std::out_of_range("file index out of range");
+        }
+        entries_.push_back(Entry{std::string(key), file, offset, length});
+    }
+
+    /**
+     * Adds the records of `data`, the contents of file `file`, keyed by the
+     * value of `key` (records without it are not indexed).
+     *
+     * Gzip input is read member by member, and each record at the beginning
+     * of a member is indexed with the offset and size of the member; invalid
+     * members are skipped up to the next gzip header.
+     */
+    void add_records(std::string_view data, std::uint64_t file, Field key)
+    {
+        Projection projection{key};
+        Record_View record;
+        auto add_record = [&](std::uint64_t offset, std::uint64_t length) {
+            if (auto const *value = record.fields().get(key); value != nullptr) {
+                add(*value, file, offset, length);
+            }
+        };
+        auto const *first = reinterpret_cast<unsigned char const *>(data.data());
+        if (not detail::is_gzip_header(first, data.size())) {
+            std::string_view in = data;
+            while (not in.empty()) {
+                if (not read_subsequent_record(in, record, projection)) {
+                    // The version is a view into the `WARC/` line that begins the record.
+                    auto begin = static_cast<std::uint64_t>(record.version().data() - data.data() -
+                                                            std::string_view("WARC/").size());
+                    add_record(begin, static_cast<std::uint64_t>(in.data() - data.data()) - begin);
+                }
+            }
+            return;
+        }
+        Member_Inflater inflater;
+        std::size_t pos = 0;
+        while (pos < data.size()) {
+            if (auto size = inflater.inflate(data.substr(pos)); size) {
+                std::string_view in = inflater.output();
+                if (not read_subsequent_record(in, record, projection)) {
+                    add_record(pos, *size);
+                }
+                pos += *size;
+                continue;
+            }
+            do {
+                ++pos;
+            } while (pos < data.size() &&
+                     not detail::is_gzip_header(first + pos, data.size() - pos));
+        }
+    }
+
+    /// Sorts the entries and writes the index to `os`.
+    void write(std::ostream &os)
+    {
+        std::sort(entries_.begin(), entries_.end(), [](Entry const &lhs, Entry const &rhs) {
+            return std::tie(lhs.key, lhs.file, lhs.offset) <
+                   std::tie(rhs.key, rhs.file, rhs.offset);
+        });
+        std::string header(detail::index_magic);
+        detail::put_u64(header, files_.size());
+        for (auto const &name : files_) {
+            detail::put_u64(header, name.size());
+            header += name;
+        }
+        detail::put_u64(header, entries_.size());
+        std::string entries;
+        entries.reserve(entries_.size() * detail::index_entry_size);
+        std::uint64_t key_offset = 0;
+        for (auto const &entry : entries_) {
+            detail::put_u64(entries, key_offset);
+            detail::put_u64(entries, entry.key.size());
+            detail::put_u64(entries, entry.file);
+            detail::put_u64(entries, entry.offset);
+            detail::put_u64(entries, entry.length);
+            key_offset += entry.key.size();
+        }
+        os.write(header.data(), static_cast<std::streamsize>(header.size()));
+        os.write(entries.data(), static_cast<std::streamsize>(entries.size()));
+        for (auto const &entry : entries_) {
+            os.write(entry.key.data(), static_cast<std::streamsize>(entry.key.size()));
+        }
+        if (not os.flush()) {
+            throw std::runtime_error("could not write index");
+        }
+    }
+};
+
+/**
+ * Searches an index held in memory, typically a `Mapped_File`.
+ *
+ * Only the file names are read on construction; lookups binary search the
+ * entries in place, so they touch about log2(size) entry and key pages.
+ * Throws `std::runtime_error` if the data is not a well-formed index.
+ */
+class Record_Index {
+   private:
+    std::vector<std::string_view> files_;
+    char const *entries_ = nullptr;
+    std::size_t size_ = 0;
+    std::string_view keys_;
+
+    [[noreturn]] static void fail() { throw std::runtime_error("invalid record index"); }
+
+    [[nodiscard]] auto field(std::size_t idx, std::size_t column) const noexcept -> std::uint64_t
+    {
+        return detail::get_u64(entries_ + idx * detail::index_entry_size + column * 8);
+    }
+
+   public:
+    explicit Record_Index(std::string_view data)
+    {
+        if (data.substr(0, detail::index_magic.size()) != detail::index_magic) {
+            fail();
+        }
+        data.remove_prefix(detail::index_magic.size());
+        auto next = [&] {
+            if (data.size() < 8) {
+                fail();
+            }
+            auto value = detail::get_u64(data.data());
+            data.remove_prefix(8);
+            return value;
+        };
+        auto file_count = next();
+        for (std::uint64_t file = 0; file < file_count; ++file) {
+            auto size = next();
+            if (size > data.size()) {
+                fail();
+            }
+            files_.push_back(data.substr(0, size));
+            data.remove_prefix(size);
+        }
+        auto size = next();
+        if (size > data.size() / detail::index_entry_size) {
+            fail();
+        }
+        size_ = static_cast<std::size_t>(size);
+        entries_ = data.data();
+        keys_ = data.substr(size_ * detail::index_entry_size);
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+    [[nodiscard]] auto files() const noexcept -> std::vector<std::string_view> const &
+    {
+        return files_;
+    }
+
+    [[nodiscard]] auto key(std::size_t idx) const -> std::string_view
+    {
+        auto offset = field(idx, 0);
+        auto size = field(idx, 1);
+        if (offset > keys_.size() || size > keys_.size() - offset) {
+            fail();
+        }
+        return keys_.substr(offset, size);
+    }
+
+    [[nodiscard]] auto operator[](std::size_t idx) const -> Index_Entry
+    {
+        auto file = field(idx, 2);
+        if (file >= files_.size()) {
+            fail();
+        }
+        return {key(idx), files_[file], field(idx, 3), field(idx, 4)};
+    }
+
+    /// Returns the range of positions of the entries with key `key`.
+    [[nodiscard]] auto equal_range(std::string_view key) const
+        -> std::pair<std::size_t, std::size_t>
+    {
+        auto partition = [&](auto before) {
+            std::size_t first = 0;
+            std::size_t count = size_;
+            while (count > 0) {
+                auto half = count / 2;
+                if (before(this->key(first + half))) {
+                    first += half + 1;
+                    count -= half + 1;
+                } else {
+                    count = half;
+                }
+            }
+            return first;
+        };
+        auto first = partition([&](std::string_view other) { return other < key; });
+        auto last = partition([&](std::string_view other) { return other <= key; });
+        return {first, last};
+    }
+
+    /// Returns the first entry with key `key`, if any.
+    [[nodiscard]] auto find(std::string_view key) const -> std::optional<Index_Entry>
+    {
+        auto [first, last] = equal_range(key);
+        if (first == last) {
+            return std::nullopt;
+        }
+        return (*this)[first];
+    }
+};
+
+/**
+ * Reads the record of `entry` from `file`, which must be the file it
+ * was indexed from, with a single seek. Gzip members are inflated
+ * transparently.
+ */
+[[nodiscard]] inline auto read_indexed_record(std::istream &file,
+                                              Index_Entry const &entry,
+                                              Record &record) -> std::optional<Error>
+{
+    file.clear();
+    if (not file.seekg(static_cast<std::streamoff>(entry.offset))) {
+        return Error(Incomplete_Record{});
+    }
+    if (is_gzip(file)) {
+        Gzip_Istream in(file);
+        return read_subsequent_record(in, record);
+    }
+    return read_record(file, record);
+}
+
+} // namespace warcpp
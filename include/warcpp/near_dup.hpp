@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "dedup.hpp"
+
+namespace warcpp {
+
+/**
+ * MinHash signatures of word shingles, banded for locality-sensitive hashing.
+ *
+ * A text is split into words at whitespace, and each run of `shingle_size`
+ * consecutive words is hashed from the hashes of its words. Each of the
+ * `bands * rows` signature values is the minimum of a different 32-bit hash
+ * function over the shingles, so two texts agree on a value with probability
+ * equal to the Jaccard similarity of their shingle sets, and on a whole band
+ * with that probability to the power of `rows`. The hash functions are
+ * computed for all values at once in a loop the compiler vectorizes.
+ */
+class Minhash {
+   private:
+    std::size_t shingle_size_;
+    std::size_t bands_;
+    std::size_t rows_;
+    std::vector<std::uint32_t> multipliers_;
+    std::vector<std::uint32_t> offsets_;
+
+   public:
+    static constexpr std::size_t max_shingle_size = 16;
+
+    /**
+     * With the default 16 bands of 8 rows, texts are candidates with
+     * probability 1/2 at a similarity of about 0.67, and 0.95 at 0.8.
+     */
+    explicit Minhash(std::size_t shingle_size = 5, std::size_t bands = 16, std::size_t rows = 8)
+        : shingle_size_(shingle_size), bands_(bands), rows_(rows)
+    {
+        if (shingle_size_ == 0 || shingle_size_ > max_shingle_size || bands_ == 0 || rows_ == 0) {
+            throw std::invalid_argument("invalid MinHash parameters");
+        }
+        for (std::size_t idx = 0; idx < size(); ++idx) {
+            auto hash = hash_128({}, idx);
+            multipliers_.push_back(static_cast<std::uint32_t>(hash.high) | 1U);
+            offsets_.push_back(static_cast<std::uint32_t>(hash.low));
+        }
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return bands_ * rows_; }
+    [[nodiscard]] auto bands() const noexcept -> std::size_t { return bands_; }
+    [[nodiscard]] auto rows() const noexcept -> std::size_t { return rows_; }
+
+    /**
+     * Computes the signature of `text` into `signature`; returns `false`,
+     * leaving it undefined, if the text has no words. A text with fewer
+     * than `shingle_size` words is a single shingle.
+     */
+    auto signature(std::string_view text, std::vector<std::uint32_t> &signature) const -> bool
+    {
+        signature.assign(size(), std::numeric_limits<std::uint32_t>::max());
+        // Hashes of the last `shingle_size` words, in a ring.
+        std::array<std::uint64_t, max_shingle_size> word_hashes{};
+        auto add_shingle = [&](std::size_t first, std::size_t count) {
+            // Combines the hashes of the words in order.
+            std::uint64_t hash = detail::hash_primes[0];
+            for (std::size_t idx = 0, slot = first; idx < count; ++idx) {
+                hash = detail::multiply_fold(hash ^ word_hashes[slot], detail::hash_primes[1]);
+                slot = slot + 1 == shingle_size_ ? 0 : slot + 1;
+            }
+            auto low = static_cast<std::uint32_t>(hash);
+            auto high = static_cast<std::uint32_t>(hash >> 32U);
+            auto const *multipliers = multipliers_.data();
+            auto const *offsets = offsets_.data();
+            auto *values = signature.data();
+            auto length = signature.size();
+            for (std::size_t idx = 0; idx < length; ++idx) {
+                std::uint32_t value = multipliers[idx] * low + (offsets[idx] ^ high);
+                value ^= value >> 16U;
+                value *= 0x85EBCA6BU;
+                value ^= value >> 13U;
+                values[idx] = std::min(values[idx], value);
+            }
+        };
+        auto is_space = [](char c) {
+            return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f';
+        };
+        std::size_t words = 0;
+        std::size_t next_slot = 0;
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            while (pos < text.size() && is_space(text[pos])) {
+                ++pos;
+            }
+            if (pos == text.size()) {
+                break;
+            }
+            auto start = pos;
+            while (pos < text.size() && not is_space(text[pos])) {
+                ++pos;
+            }
+            word_hashes[next_slot] = hash_128(text.substr(start, pos - start)).low;
+            next_slot = next_slot + 1 == shingle_size_ ? 0 : next_slot + 1;
+            ++words;
+            if (words >= shingle_size_) {
+                // The oldest word is the one in the next slot.
+                add_shingle(next_slot, shingle_size_);
+            }
+        }
+        if (words > 0 && words < shingle_size_) {
+            add_shingle(0, words);
+        }
+        return words > 0;
+    }
+
+    /// Hashes each band of `signature` into `hashes`.
+    void band_hashes(std::vector<std::uint32_t> const &signature,
+                     std::vector<std::uint64_t> &hashes) const
+    {
+        hashes.resize(bands_);
+        for (std::size_t band = 0; band < bands_; ++band) {
+            std::string_view values(
+                reinterpret_cast<char const *>(signature.data() + band * rows_),
+                rows_ * sizeof(std::uint32_t));
+            hashes[band] = hash_128(values, band).low;
+        }
+    }
+};
+
+/**
+ * Locality-sensitive hash table of band hashes in a fixed amount of memory.
+ *
+ * Each band has its own table of 4-way buckets; a bucket keeps its most
+ * recently inserted or matched band hashes, so once the table fills up,
+ * texts are only compared with those seen recently enough. Entries take
+ * 16 bytes, in anonymous memory that is only committed as it is used.
+ * Not thread-safe.
+ */
+class Lsh_Table {
+   private:
+    struct Entry {
+        std::uint64_t key = 0;
+        std::uint64_t cluster = 0;
+    };
+    static constexpr std::size_t ways = 4;
+
+    std::size_t bands_;
+    std::size_t buckets_ = 1;
+    detail::Mapped_Region region_;
+
+    [[nodiscard]] auto entries() const noexcept -> Entry *
+    {
+        return static_cast<Entry *>(region_.data());
+    }
+
+   public:
+    /// Creates a table for `bands` bands in at most `memory` bytes, but at least a bucket per band.
+    Lsh_Table(std::size_t bands, std::size_t memory) : bands_(bands)
+    {
+        while (buckets_ * 2 * ways * sizeof(Entry) * bands_ <= memory) {
+            buckets_ *= 2;
+        }
+        region_ = detail::Mapped_Region(bands_ * buckets_ * ways * sizeof(Entry));
+    }
+
+    [[nodiscard]] auto memory() const noexcept -> std::size_t { return region_.size(); }
+
+    /**
+     * Returns the cluster of the text with band hashes `hashes`: the
+     * smallest cluster among entries sharing a band with it, or `id` if
+     * there is none. Then stores its bands with that cluster.
+     *
+     * Passing increasing ids, such as record ordinals, makes each cluster
+     * the id of its earliest text still in the table.
+     */
+    auto insert(std::vector<std::uint64_t> const &hashes, std::uint64_t id) -> std::uint64_t
+    {
+        if (hashes.size() != bands_) {
+            throw std::invalid_argument("wrong number of bands");
+        }
+        auto key_of = [](std::uint64_t hash) { return hash == 0 ? 1 : hash; };
+        auto bucket = [&](std::size_t band) {
+            auto key = key_of(hashes[band]);
+            auto offset = (band * buckets_ + ((key >> 32U) & (buckets_ - 1))) * ways;
+            return entries() + offset;
+        };
+        auto cluster = id;
+        for (std::size_t band = 0; band < bands_; ++band) {
+            auto const *entries = bucket(band);
+            for (std::size_t way = 0; way < ways; ++way) {
+                if (entries[way].key == key_of(hashes[band])) {
+                    cluster = std::min(cluster, entries[way].cluster);
+                }
+            }
+        }
+        for (std::size_t band = 0; band < bands_; ++band) {
+            auto *entries = bucket(band);
+            auto key = key_of(hashes[band]);
+            auto way = static_cast<std::size_t>(
+                std::find_if(entries, entries + ways - 1, [&](Entry const &entry) {
+                    return entry.key == key;
+                }) -
+                entries);
+            std::copy_backward(entries, entries + way, entries + way + 1);
+            entries[0] = Entry{key, cluster};
+        }
+        return cluster;
+    }
+};
+
+} // namespace warcpp
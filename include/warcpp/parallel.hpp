@@ -0,0 +1,526 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gzip.hpp"
+#include "warcpp.hpp"
+
+namespace warcpp {
+
+namespace detail {
+
+    [[nodiscard]] inline auto default_thread_count() noexcept -> std::size_t
+    {
+        return std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * Bounded buffer putting results computed out of order back in order.
+     *
+     * A producer may only `put` an item whose index is within `window` of the
+     * next item to be taken, which bounds the memory used by items that were
+     * computed early. Items are taken strictly in index order.
+     */
+    template <typename T>
+    class Reorder_Buffer {
+       private:
+        struct Slot {
+            std::optional<T> value;
+        };
+        std::vector<Slot> slots_;
+        std::size_t next_ = 0;
+        bool stopped_ = false;
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::condition_variable space_;
+
+       public:
+        explicit Reorder_Buffer(std::size_t window) : slots_(std::max<std::size_t>(window, 1)) {}
+
+        /// Blocks until `index` fits in the window; returns `false` if stopped.
+        [[nodiscard]] auto wait_for_slot(std::size_t index) -> bool
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_.wait(lock, [&] { return stopped_ || index < next_ + slots_.size(); });
+            return not stopped_;
+        }
+
+        /// Stores the item at `index`; `wait_for_slot(index)` must have returned `true`.
+        void put(std::size_t index, T value)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                slots_[index % slots_.size()].value = std::move(value);
+            }
+            ready_.notify_all();
+        }
+
+        /// Blocks until the next item in order is available and returns it.
+        [[nodiscard]] auto take() -> std::optional<T>
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto &slot = slots_[next_ % slots_.size()];
+            ready_.wait(lock, [&] { return stopped_ || slot.value.has_value(); });
+            if (not slot.value) {
+                return std::nullopt;
+            }
+            auto value = std::move(slot.value);
+            slot.value.reset();
+            ++next_;
+            lock.unlock();
+            space_.notify_all();
+            return value;
+        }
+
+        /// Wakes up and releases all waiting threads.
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopped_ = true;
+            }
+            ready_.notify_all();
+            space_.notify_all();
+        }
+    };
+
+    /**
+     * Runs `transform(index)` for all indices in `[0, count)` on `threads`
+     * worker threads and passes the results to `consume` in index order
+     * on the calling thread. At most `window` results are held at a time.
+     * An exception thrown by `transform` or `consume` stops all workers
+     * and is rethrown.
+     */
+    template <typename Transform, typename Consume>
+    void ordered_parallel_for(std::size_t count,
+                              Transform &&transform,
+                              Consume &&consume,
+                              std::size_t threads,
+                              std::size_t window)
+    {
+        using Value = std::decay_t<decltype(transform(std::size_t{}))>;
+        Reorder_Buffer<Value> buffer(window);
+        std::atomic_size_t next_index{0};
+        std::exception_ptr worker_error = nullptr;
+        std::mutex error_mutex;
+        std::vector<std::thread> workers;
+        threads = std::max<std::size_t>(1, std::min(threads, count));
+        for (std::size_t worker = 0; worker < threads; ++worker) {
+            workers.emplace_back([&] {
+                try {
+                    for (auto index = next_index++; index < count; index = next_index++) {
+                        if (not buffer.wait_for_slot(index)) {
+                            return;
+                        }
+                        buffer.put(index, transform(index));
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    worker_error = std::current_exception();
+                    buffer.stop();
+                }
+            });
+        }
+        std::exception_ptr consumer_error = nullptr;
+        try {
+            for (std::size_t index = 0; index < count; ++index) {
+                auto value = buffer.take();
+                if (not value) {
+                    break;
+                }
+                consume(std::move(*value));
+            }
+        } catch (...) {
+            consumer_error = std::current_exception();
+        }
+        buffer.stop();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        if (consumer_error) {
+            std::rethrow_exception(consumer_error);
+        }
+        if (worker_error) {
+            std::rethrow_exception(worker_error);
+        }
+    }
+
+    /**
+     * Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's
+     * algorithm) of small copyable items. Each cell carries a sequence number
+     * telling whether it is ready to be written or read in the current lap,
+     * so producers and consumers only contend on their own position counter.
+     */
+    template <typename T>
+    class Bounded_Queue {
+       private:
+        struct Cell {
+            std::atomic_size_t sequence{0};
+            T value{};
+        };
+        std::unique_ptr<Cell[]> cells_;
+        std::size_t mask_;
+        alignas(64) std::atomic_size_t push_position_{0};
+        alignas(64) std::atomic_size_t pop_position_{0};
+
+        [[nodiscard]] static auto round_up(std::size_t capacity) noexcept -> std::size_t
+        {
+            std::size_t size = 2;
+            while (size < capacity) {
+                size *= 2;
+            }
+            return size;
+        }
+
+       public:
+        /// Creates a queue holding at least `capacity` items.
+        explicit Bounded_Queue(std::size_t capacity)
+            : cells_(std::make_unique<Cell[]>(round_up(capacity))), mask_(round_up(capacity) - 1)
+        {
+            for (std::size_t idx = 0; idx <= mask_; ++idx) {
+                cells_[idx].sequence.store(idx, std::memory_order_relaxed);
+            }
+        }
+
+        /// Appends `value`; returns `false` if the queue is full.
+        [[nodiscard]] auto try_push(T const &value) noexcept -> bool
+        {
+            auto position = push_position_.load(std::memory_order_relaxed);
+            while (true) {
+                auto &cell = cells_[position & mask_];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(sequence - position);
+                if (diff == 0) {
+                    if (push_position_.compare_exchange_weak(
+                            position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = push_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /// Removes the oldest item into `value`; returns `false` if the queue is empty.
+        [[nodiscard]] auto try_pop(T &value) noexcept -> bool
+        {
+            auto position = pop_position_.load(std::memory_order_relaxed);
+            while (true) {
+                auto &cell = cells_[position & mask_];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+                if (diff == 0) {
+                    if (pop_position_.compare_exchange_weak(
+                            position, position + 1, std::memory_order_relaxed)) {
+                        value = cell.value;
+                        cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = pop_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    /**
+     * Runs a three-stage pipeline connected by bounded lock-free queues.
+     * `produce(Batch&) -> bool` fills batches on a dedicated thread until it
+     * returns `false`; `transform(Batch&)` processes them on `threads` worker
+     * threads; and `consume(Batch&)` is called on the calling thread with the
+     * batches in the order they were produced. Only `depth` batches exist,
+     * recycled from `consume` back to `produce`, so their buffers are reused
+     * and memory stays bounded. An exception thrown by any stage stops the
+     * pipeline and is rethrown.
+     */
+    template <typename Batch, typename Produce, typename Transform, typename Consume>
+    void ordered_pipeline(Produce &&produce,
+                          Transform &&transform,
+                          Consume &&consume,
+                          std::size_t threads,
+                          std::size_t depth)
+    {
+        struct Item {
+            std::size_t sequence = 0;
+            std::size_t slot = 0;
+        };
+        depth = std::max<std::size_t>(depth, 1);
+        std::vector<Batch> batches(depth);
+        Bounded_Queue<std::size_t> free_slots(depth);
+        Bounded_Queue<Item> work(depth);
+        Bounded_Queue<Item> done(depth);
+        for (std::size_t slot = 0; slot < depth; ++slot) {
+            (void)free_slots.try_push(slot);
+        }
+        std::atomic_bool stopped{false};
+        std::atomic_bool finished{false};
+        std::atomic_size_t total{0};
+        std::exception_ptr error = nullptr;
+        std::mutex error_mutex;
+        auto fail = [&] {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (not error) {
+                error = std::current_exception();
+            }
+            stopped = true;
+        };
+        auto push = [&](auto &queue, auto const &value) {
+            while (not queue.try_push(value)) {
+                if (stopped) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        };
+
+        std::thread producer([&] {
+            try {
+                std::size_t sequence = 0;
+                std::size_t slot = 0;
+                while (not stopped) {
+                    if (not free_slots.try_pop(slot)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    if (not produce(batches[slot]) || not push(work, Item{sequence, slot})) {
+                        break;
+                    }
+                    ++sequence;
+                }
+                total = sequence;
+            } catch (...) {
+                fail();
+            }
+            finished = true;
+        });
+        std::vector<std::thread> workers;
+        for (std::size_t worker = 0; worker < std::max<std::size_t>(threads, 1); ++worker) {
+            workers.emplace_back([&] {
+                try {
+                    Item item;
+                    while (not stopped) {
+                        if (not work.try_pop(item)) {
+                            if (not finished) {
+                                std::this_thread::yield();
+                                continue;
+                            }
+                            // Items are pushed before `finished` is set, so one more try suffices.
+                            if (not work.try_pop(item)) {
+                                return;
+                            }
+                        }
+                        transform(batches[item.slot]);
+                        if (not push(done, item)) {
+                            return;
+                        }
+                    }
+                } catch (...) {
+                    fail();
+                }
+            });
+        }
+        try {
+            // In-flight sequence numbers span less than `depth`, so they map to distinct positions.
+            std::vector<std::size_t> pending(depth, depth);
+            std::size_t next = 0;
+            Item item;
+            while (not stopped && not (finished && next == total)) {
+                if (not done.try_pop(item)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                pending[item.sequence % depth] = item.slot;
+                while (pending[next % depth] != depth) {
+                    auto slot = std::exchange(pending[next % depth], depth);
+                    consume(batches[slot]);
+                    if (not push(free_slots, slot)) {
+                        break;
+                    }
+                    ++next;
+                }
+            }
+        } catch (...) {
+            fail();
+        }
+        stopped = true;
+        producer.join();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * Calls `fn(index)` for all indices in `[0, count)` on `threads` threads.
+     * Each thread gets a contiguous block of indices, which it processes in
+     * increasing order; a thread that runs out of work steals indices from
+     * the back of another thread's block. This balances tasks of very
+     * different sizes, such as whole files. An exception thrown by `fn`
+     * stops all threads and is rethrown.
+     */
+    template <typename Fn>
+    void work_stealing_for(std::size_t count, Fn &&fn, std::size_t threads)
+    {
+        struct Tasks {
+            std::mutex mutex;
+            std::size_t first = 0;
+            std::size_t last = 0;
+        };
+        threads = std::max<std::size_t>(1, std::min(threads, count));
+        std::vector<Tasks> tasks(threads);
+        for (std::size_t thread = 0; thread < threads; ++thread) {
+            tasks[thread].first = count * thread / threads;
+            tasks[thread].last = count * (thread + 1) / threads;
+        }
+        std::atomic_bool stopped{false};
+        std::exception_ptr error = nullptr;
+        std::mutex error_mutex;
+        auto run = [&](std::size_t thread) {
+            try {
+                while (not stopped) {
+                    std::optional<std::size_t> index;
+                    {
+                        std::lock_guard<std::mutex> lock(tasks[thread].mutex);
+                        if (tasks[thread].first < tasks[thread].last) {
+                            index = tasks[thread].first++;
+                        }
+                    }
+                    for (std::size_t offset = 1; not index && offset < threads; ++offset) {
+                        auto &victim = tasks[(thread + offset) % threads];
+                        std::lock_guard<std::mutex> lock(victim.mutex);
+                        if (victim.first < victim.last) {
+                            index = --victim.last;
+                        }
+                    }
+                    if (not index) {
+                        return;
+                    }
+                    fn(*index);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (not error) {
+                    error = std::current_exception();
+                }
+                stopped = true;
+            }
+        };
+        std::vector<std::thread> workers;
+        for (std::size_t thread = 1; thread < threads; ++thread) {
+            workers.emplace_back(run, thread);
+        }
+        run(0);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    struct Decoded_Member {
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        bool valid = false;
+        std::vector<Result> records{};
+    };
+
+} // namespace detail
+
+struct Parallel_Options {
+    /// Number of worker threads inflating and parsing members.
+    std::size_t threads = detail::default_thread_count();
+    /// Maximum number of decoded members held in memory at once.
+    std::size_t window = 256;
+    /// Member offsets, e.g., from a sidecar index; if empty, the input is scanned for members.
+    std::vector<std::uint64_t> member_offsets{};
+};
+
+/**
+ * Decodes a gzip-per-record WARC file in parallel.
+ *
+ * Members are located either from `options.member_offsets` or by scanning
+ * `data` for gzip headers. Each member is inflated and parsed by a worker
+ * thread, and `fn` is called on the calling thread with each `Result`
+ * in the original order. Candidate headers found inside compressed data
+ * are discarded because they start before the end of the previous member
+ * or do not inflate; members that fail to inflate are skipped.
+ */
+template <typename Fn>
+void parallel_read(std::string_view data, Fn &&fn, Parallel_Options options = {})
+{
+    auto offsets = options.member_offsets.empty() ? find_gzip_members(data)
+                                                  : std::move(options.member_offsets);
+    std::vector<std::unique_ptr<Member_Inflater>> inflaters;
+    std::mutex inflaters_mutex;
+    auto decode = [&](std::size_t index) {
+        detail::Decoded_Member member;
+        member.begin = offsets[index];
+        if (member.begin >= data.size()) {
+            return member;
+        }
+        std::unique_ptr<Member_Inflater> inflater;
+        {
+            std::lock_guard<std::mutex> lock(inflaters_mutex);
+            if (not inflaters.empty()) {
+                inflater = std::move(inflaters.back());
+                inflaters.pop_back();
+            }
+        }
+        if (not inflater) {
+            inflater = std::make_unique<Member_Inflater>();
+        }
+        if (auto size = inflater->inflate(data.substr(member.begin)); size) {
+            member.valid = true;
+            member.end = member.begin + *size;
+            std::string_view in = inflater->output();
+            Record_View view;
+            while (not in.empty()) {
+                if (auto error = read_subsequent_record(in, view); error) {
+                    if (std::get_if<Invalid_Version>(&*error) == nullptr || not in.empty()) {
+                        member.records.emplace_back(std::move(*error));
+                    }
+                } else {
+                    member.records.emplace_back(Record(view));
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(inflaters_mutex);
+        inflaters.push_back(std::move(inflater));
+        return member;
+    };
+    std::uint64_t expected = 0;
+    auto consume = [&](detail::Decoded_Member member) {
+        if (not member.valid || member.begin < expected) {
+            return;
+        }
+        expected = member.end;
+        for (auto &record : member.records) {
+            fn(std::move(record));
+        }
+    };
+    detail::ordered_parallel_for(offsets.size(), decode, consume, options.threads, options.window);
+}
+
+} // namespace warcpp
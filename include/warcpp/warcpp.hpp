@@ -1,12 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace warcpp {
 
@@ -19,11 +39,209 @@ using Error = std::variant<Invalid_Version,
                            Missing_Mandatory_Fields,
                            Incomplete_Record>;
 class Record;
+class Record_View;
 using Result = std::variant<Record, Error>;
 
+/// Named fields defined by WARC 1.0 and 1.1, plus the ClueWeb `WARC-TREC-ID`.
+enum class Field : std::uint8_t {
+    Warc_Type,
+    Warc_Record_Id,
+    Warc_Date,
+    Content_Length,
+    Content_Type,
+    Warc_Concurrent_To,
+    Warc_Block_Digest,
+    Warc_Payload_Digest,
+    Warc_Ip_Address,
+    Warc_Refers_To,
+    Warc_Refers_To_Target_Uri,
+    Warc_Refers_To_Date,
+    Warc_Target_Uri,
+    Warc_Truncated,
+    Warc_Warcinfo_Id,
+    Warc_Filename,
+    Warc_Profile,
+    Warc_Identified_Payload_Type,
+    Warc_Segment_Number,
+    Warc_Segment_Origin_Id,
+    Warc_Segment_Total_Length,
+    Warc_Trec_Id,
+    Unknown
+};
+
+constexpr std::size_t field_count = static_cast<std::size_t>(Field::Unknown);
+
 namespace detail {
 
-    using Field_Map = std::unordered_map<std::string, std::string>;
+    constexpr std::array<std::string_view, field_count> field_names = {
+        "warc-type",
+        "warc-record-id",
+        "warc-date",
+        "content-length",
+        "content-type",
+        "warc-concurrent-to",
+        "warc-block-digest",
+        "warc-payload-digest",
+        "warc-ip-address",
+        "warc-refers-to",
+        "warc-refers-to-target-uri",
+        "warc-refers-to-date",
+        "warc-target-uri",
+        "warc-truncated",
+        "warc-warcinfo-id",
+        "warc-filename",
+        "warc-profile",
+        "warc-identified-payload-type",
+        "warc-segment-number",
+        "warc-segment-origin-id",
+        "warc-segment-total-length",
+        "warc-trec-id"};
+
+    constexpr std::size_t field_table_size = 64;
+
+    [[nodiscard]] constexpr auto to_lower(char c) noexcept -> char
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /// Case-insensitive FNV-1a hash of `name` reduced to a field table index.
+    [[nodiscard]] constexpr auto field_hash(std::string_view name, std::uint32_t seed) noexcept
+        -> std::size_t
+    {
+        std::uint32_t hash = 2166136261U ^ seed;
+        for (char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(to_lower(c))) * 16777619U;
+        }
+        return (hash ^ (hash >> 16U)) % field_table_size;
+    }
+
+    /// Finds a seed for which `field_hash` has no collisions among `names`.
+    template <std::size_t N>
+    [[nodiscard]] constexpr auto find_field_seed(
+        std::array<std::string_view, N> const &names) noexcept -> std::uint32_t
+    {
+        static_assert(N <= field_table_size);
+        for (std::uint32_t seed = 0;; ++seed) {
+            std::array<bool, field_table_size> taken{};
+            bool collision = false;
+            for (auto name : names) {
+                auto &slot = taken[field_hash(name, seed)];
+                collision = collision || slot;
+                slot = true;
+            }
+            if (not collision) {
+                return seed;
+            }
+        }
+    }
+
+    constexpr std::uint32_t field_seed = find_field_seed(field_names);
+
+    [[nodiscard]] constexpr auto make_field_table() noexcept
+        -> std::array<Field, field_table_size>
+    {
+        std::array<Field, field_table_size> table{};
+        for (auto &id : table) {
+            id = Field::Unknown;
+        }
+        for (std::size_t idx = 0; idx < field_count; ++idx) {
+            table[field_hash(field_names[idx], field_seed)] = static_cast<Field>(idx);
+        }
+        return table;
+    }
+
+    constexpr std::array<Field, field_table_size> field_table = make_field_table();
+
+    [[nodiscard]] constexpr auto iequals_lower(std::string_view name,
+                                               std::string_view lowercase) noexcept -> bool
+    {
+        if (name.size() != lowercase.size()) {
+            return false;
+        }
+        for (std::size_t idx = 0; idx < name.size(); ++idx) {
+            if (to_lower(name[idx]) != lowercase[idx]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace detail
+
+/// Canonical (lowercase) name of a standard field.
+[[nodiscard]] constexpr auto field_name(Field id) noexcept -> std::string_view
+{
+    return id == Field::Unknown ? std::string_view{}
+                                : detail::field_names[static_cast<std::size_t>(id)];
+}
+
+/**
+ * Maps a field name, regardless of its case, to its standard ID, or to
+ * `Field::Unknown`. The lookup costs one hash and one comparison.
+ */
+[[nodiscard]] constexpr auto field_id(std::string_view name) noexcept -> Field
+{
+    auto id = detail::field_table[detail::field_hash(name, detail::field_seed)];
+    return id != Field::Unknown && detail::iequals_lower(name, field_name(id)) ? id
+                                                                               : Field::Unknown;
+}
+
+static_assert(field_id("WARC-Type") == Field::Warc_Type);
+static_assert(field_id("content-length") == Field::Content_Length);
+static_assert(field_id("X-Custom") == Field::Unknown);
+
+/**
+ * Set of fields to keep when parsing records.
+ *
+ * Fields outside of the projection are skipped right after their names are
+ * recognized: their values are neither trimmed nor stored. `WARC-Type` and
+ * `Content-Length` are always kept because reading a record requires them.
+ * Non-standard fields are either all kept or all skipped.
+ */
+class Projection {
+   private:
+    std::uint32_t fields_ = ~0U;
+    bool others_ = true;
+
+    [[nodiscard]] static constexpr auto bit(Field id) noexcept -> std::uint32_t
+    {
+        return 1U << static_cast<std::uint32_t>(id);
+    }
+
+   public:
+    /// Keeps all fields.
+    constexpr Projection() = default;
+
+    /// Keeps only `fields`, and non-standard fields if `others` is `true`.
+    constexpr Projection(std::initializer_list<Field> fields, bool others = false)
+        : fields_(bit(Field::Warc_Type) | bit(Field::Content_Length)), others_(others)
+    {
+        for (auto id : fields) {
+            if (id != Field::Unknown) {
+                fields_ |= bit(id);
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr auto contains(Field id) const noexcept -> bool
+    {
+        return id == Field::Unknown ? others_ : (fields_ & bit(id)) != 0;
+    }
+
+    /// Returns a copy that also keeps `id`.
+    [[nodiscard]] constexpr auto with(Field id) const noexcept -> Projection
+    {
+        Projection projection = *this;
+        if (id == Field::Unknown) {
+            projection.others_ = true;
+        } else {
+            projection.fields_ |= bit(id);
+        }
+        return projection;
+    }
+};
+
+namespace detail {
 
     template <class... Ts>
     struct overloaded : Ts... {
@@ -51,112 +269,613 @@ namespace detail {
         return StringRange(begin, end);
     }
 
-    [[nodiscard]] auto read_fields(std::istream &in, Field_Map &fields)
+    /**
+     * Returns a mask with bit `i` set if `data[i]` equals any of `Cs`,
+     * for the `simd_width` bytes starting at `data`.
+     */
+#if defined(__AVX2__)
+    constexpr std::size_t simd_width = 32;
+    template <char... Cs>
+    [[nodiscard]] inline auto match_any(char const *data) noexcept -> std::uint32_t
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data));
+        auto matches = _mm256_setzero_si256();
+        ((matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Cs)))), ...);
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(matches));
+    }
+    /// Same as `match_any` for control characters (below 0x20).
+    [[nodiscard]] inline auto match_control(char const *data) noexcept -> std::uint32_t
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data));
+        auto clamped = _mm256_min_epu8(block, _mm256_set1_epi8(0x1f));
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(clamped, block)));
+    }
+    /// Same as `match_any` for bytes that are not ASCII (0x80 and above).
+    [[nodiscard]] inline auto match_non_ascii(char const *data) noexcept -> std::uint32_t
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data));
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(block));
+    }
+#elif defined(__SSE2__)
+    constexpr std::size_t simd_width = 16;
+    template <char... Cs>
+    [[nodiscard]] inline auto match_any(char const *data) noexcept -> std::uint32_t
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data));
+        auto matches = _mm_setzero_si128();
+        ((matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, _mm_set1_epi8(Cs)))), ...);
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(matches));
+    }
+    [[nodiscard]] inline auto match_control(char const *data) noexcept -> std::uint32_t
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data));
+        auto clamped = _mm_min_epu8(block, _mm_set1_epi8(0x1f));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(clamped, block)));
+    }
+    [[nodiscard]] inline auto match_non_ascii(char const *data) noexcept -> std::uint32_t
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(block));
+    }
+#else
+    constexpr std::size_t simd_width = 0;
+    template <char... Cs>
+    [[nodiscard]] inline auto match_any(char const *) noexcept -> std::uint32_t
+    {
+        return 0;
+    }
+    [[nodiscard]] inline auto match_control(char const *) noexcept -> std::uint32_t { return 0; }
+    [[nodiscard]] inline auto match_non_ascii(char const *) noexcept -> std::uint32_t { return 0; }
+#endif
+
+    [[nodiscard]] inline auto count_trailing_zeros(std::uint32_t mask) noexcept -> std::size_t
+    {
+        return static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+
+    [[nodiscard]] inline auto is_space(char c) noexcept -> bool
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    [[nodiscard]] inline auto trim_view(std::string_view str) noexcept -> std::string_view
+    {
+        while (not str.empty() && is_space(str.front())) {
+            str.remove_prefix(1);
+        }
+        while (not str.empty() && is_space(str.back())) {
+            str.remove_suffix(1);
+        }
+        return str;
+    }
+
+    [[nodiscard]] inline auto iequals(std::string_view lhs, std::string_view rhs) noexcept -> bool
+    {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        for (std::size_t idx = 0; idx < lhs.size(); ++idx) {
+            if (std::tolower(static_cast<unsigned char>(lhs[idx])) !=
+                std::tolower(static_cast<unsigned char>(rhs[idx]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Returns the next line (without the trailing `\n`) and advances `in` past it.
+    [[nodiscard]] inline auto next_line(std::string_view &in) noexcept -> std::string_view
+    {
+        auto pos = in.find('\n');
+        auto line = in.substr(0, pos);
+        in.remove_prefix(pos == std::string_view::npos ? in.size() : pos + 1);
+        return line;
+    }
+
+    /**
+     * Record fields: standard fields are stored in slots indexed by `Field`,
+     * and others in an overflow list searched linearly. Clearing the map
+     * keeps all allocated strings, so refilling it does not allocate
+     * as long as the values fit.
+     */
+    template <typename String>
+    class Basic_Field_Map {
+       private:
+        static_assert(field_count <= 32);
+        std::array<String, field_count> values_{};
+        std::uint32_t present_ = 0;
+        std::vector<std::pair<String, String>> overflow_{};
+        std::size_t overflow_size_ = 0;
+
+        [[nodiscard]] static constexpr auto bit(Field id) noexcept -> std::uint32_t
+        {
+            return 1U << static_cast<std::uint32_t>(id);
+        }
+
+        [[nodiscard]] auto find_overflow(std::string_view name) const noexcept
+            -> std::pair<String, String> const *
+        {
+            for (std::size_t idx = 0; idx < overflow_size_; ++idx) {
+                if (iequals(overflow_[idx].first, name)) {
+                    return &overflow_[idx];
+                }
+            }
+            return nullptr;
+        }
+
+       public:
+        [[nodiscard]] auto has(Field id) const noexcept -> bool
+        {
+            return (present_ & bit(id)) != 0;
+        }
+
+        [[nodiscard]] auto get(Field id) const noexcept -> String const *
+        {
+            return has(id) ? &values_[static_cast<std::size_t>(id)] : nullptr;
+        }
+
+        [[nodiscard]] auto at(Field id) const -> String const &
+        {
+            if (not has(id)) {
+                throw std::out_of_range(std::string(field_name(id)));
+            }
+            return values_[static_cast<std::size_t>(id)];
+        }
+
+        [[nodiscard]] auto at(Field id) -> String &
+        {
+            return const_cast<String &>(std::as_const(*this).at(id));
+        }
+
+        /// Looks up a field by its name, case-insensitively.
+        [[nodiscard]] auto find(std::string_view name) const noexcept -> String const *
+        {
+            if (auto id = field_id(name); id != Field::Unknown) {
+                return get(id);
+            }
+            auto *entry = find_overflow(name);
+            return entry != nullptr ? &entry->second : nullptr;
+        }
+
+        /// Returns the (cleared) slot of a standard field, marking it present.
+        [[nodiscard]] auto slot(Field id) -> String &
+        {
+            auto &value = values_[static_cast<std::size_t>(id)];
+            if (not has(id)) {
+                present_ |= bit(id);
+                value = String{};
+            }
+            return value;
+        }
+
+        /**
+         * Returns the value of the named field, inserting an empty one if missing.
+         * Names of non-standard fields are stored in lowercase when owned.
+         */
+        [[nodiscard]] auto operator[](std::string_view name) -> String &
+        {
+            if (auto id = field_id(name); id != Field::Unknown) {
+                return slot(id);
+            }
+            if (auto *entry = find_overflow(name); entry != nullptr) {
+                return const_cast<String &>(entry->second);
+            }
+            if (overflow_size_ == overflow_.size()) {
+                overflow_.emplace_back();
+            }
+            auto &[entry_name, entry_value] = overflow_[overflow_size_++];
+            entry_name = name;
+            if constexpr (std::is_same_v<String, std::string>) {
+                std::transform(entry_name.begin(),
+                               entry_name.end(),
+                               entry_name.begin(),
+                               [](char c) { return to_lower(c); });
+                entry_value.clear();
+            } else {
+                entry_value = String{};
+            }
+            return entry_value;
+        }
+
+        void clear() noexcept
+        {
+            present_ = 0;
+            overflow_size_ = 0;
+        }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return static_cast<std::size_t>(__builtin_popcount(present_)) + overflow_size_;
+        }
+
+        /// Calls `fn(name, value)` for each field: standard ones first, in `Field` order.
+        template <typename Fn>
+        void for_each(Fn &&fn) const
+        {
+            for (std::size_t idx = 0; idx < field_count; ++idx) {
+                if (has(static_cast<Field>(idx))) {
+                    fn(field_names[idx], values_[idx]);
+                }
+            }
+            for (std::size_t idx = 0; idx < overflow_size_; ++idx) {
+                fn(std::string_view(overflow_[idx].first), overflow_[idx].second);
+            }
+        }
+    };
+
+    using Field_Map = Basic_Field_Map<std::string>;
+    using View_Field_Map = Basic_Field_Map<std::string_view>;
+
+    /**
+     * Scans a header block at the beginning of `in` in a single pass,
+     * calling `emit(name, value)` with trimmed views of each field,
+     * and advances `in` past the empty line ending the block.
+     *
+     * Line feeds and colons are located `simd_width` bytes at a time;
+     * only the first colon of each line is significant. If `keep(name)`
+     * returns `false`, the field is skipped before its value is trimmed.
+     */
+    template <typename Fn, typename Filter>
+    [[nodiscard]] auto scan_fields(std::string_view &in, Fn &&emit, Filter &&keep)
         -> std::optional<Invalid_Field>
     {
-        std::string line;
-        std::getline(in, line);
-        while (not line.empty() && line != "\r") {
-            auto [name, value] = split(line, ':');
+        auto const *data = in.data();
+        std::size_t const size = in.size();
+        std::size_t line_start = 0;
+        std::size_t colon = std::string_view::npos;
+        std::optional<Invalid_Field> error = std::nullopt;
+        // Returns `true` if scanning should stop: at the end of the block or on error.
+        auto end_line = [&](std::size_t line_end) {
+            std::string_view line(data + line_start, line_end - line_start);
+            if (line.empty() || line == "\r") {
+                return true;
+            }
+            auto name = line.substr(0, colon == std::string_view::npos ? line.size()
+                                                                       : colon - line_start);
+            auto value = colon == std::string_view::npos ? std::string_view{}
+                                                         : line.substr(colon - line_start + 1);
             if (name.empty() || value.empty()) {
-                return Invalid_Field{line};
+                error = Invalid_Field{std::string(line)};
+                return true;
+            }
+            if (name = trim_view(name); keep(name)) {
+                emit(name, trim_view(value));
+            }
+            line_start = line_end + 1;
+            colon = std::string_view::npos;
+            return false;
+        };
+        auto visit = [&](std::size_t pos) {
+            if (data[pos] == ':') {
+                colon = std::min(colon, pos);
+                return false;
+            }
+            return end_line(pos);
+        };
+        std::size_t pos = 0;
+        for (; simd_width > 0 && pos + simd_width <= size; pos += simd_width) {
+            for (auto mask = match_any<'\n', ':'>(data + pos); mask != 0; mask &= mask - 1) {
+                if (auto idx = pos + count_trailing_zeros(mask); visit(idx)) {
+                    in.remove_prefix(std::min(idx + 1, size));
+                    return error;
+                }
             }
-            name = trim(name);
-            value = trim(value);
-            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
-                return std::tolower(c);
-            });
-            fields[std::string(name.begin(), name.end())] = std::string(value.begin(), value.end());
-            std::getline(in, line);
         }
-        return std::nullopt;
+        for (; pos < size; ++pos) {
+            if ((data[pos] == '\n' || data[pos] == ':') && visit(pos)) {
+                in.remove_prefix(pos + 1);
+                return error;
+            }
+        }
+        // Last line not terminated by a line feed.
+        if (line_start < size) {
+            end_line(size);
+        }
+        in.remove_prefix(size);
+        return error;
+    }
+
+    template <typename Fn>
+    [[nodiscard]] auto scan_fields(std::string_view &in, Fn &&emit) -> std::optional<Invalid_Field>
+    {
+        return scan_fields(in, std::forward<Fn>(emit), [](std::string_view) { return true; });
+    }
+
+    /**
+     * Reads lines up to and including the first empty line into `block`.
+     * `block` is cleared first but keeps its capacity.
+     */
+    inline void read_header_block(std::istream &in, std::string &block)
+    {
+        block.clear();
+        std::istream::sentry sentry(in, true);
+        if (not sentry) {
+            return;
+        }
+        auto *buffer = in.rdbuf();
+        std::size_t line_start = 0;
+        while (true) {
+            auto c = buffer->sbumpc();
+            if (c == std::char_traits<char>::eof()) {
+                in.setstate(block.empty() ? std::ios::eofbit | std::ios::failbit
+                                          : std::ios::eofbit);
+                return;
+            }
+            block.push_back(static_cast<char>(c));
+            if (c == '\n') {
+                auto length = block.size() - 1 - line_start;
+                if (length == 0 || (length == 1 && block[line_start] == '\r')) {
+                    return;
+                }
+                line_start = block.size();
+            }
+        }
+    }
+
+    /// Stores fields in the projection; the name is recognized once, by `keep`.
+    template <typename Map>
+    [[nodiscard]] auto scan_fields_into(std::string_view &in,
+                                        Map &fields,
+                                        Projection const &projection)
+        -> std::optional<Invalid_Field>
+    {
+        Field id = Field::Unknown;
+        return scan_fields(
+            in,
+            [&](std::string_view name, std::string_view value) {
+                auto &slot = id == Field::Unknown ? fields[name] : fields.slot(id);
+                if constexpr (std::is_same_v<Map, Basic_Field_Map<std::string>>) {
+                    slot.assign(value.data(), value.size());
+                } else {
+                    slot = value;
+                }
+            },
+            [&](std::string_view name) {
+                id = field_id(name);
+                return projection.contains(id);
+            });
+    }
+
+    [[nodiscard]] auto read_fields(std::istream &in,
+                                   Field_Map &fields,
+                                   Projection const &projection = {})
+        -> std::optional<Invalid_Field>
+    {
+        thread_local std::string block;
+        read_header_block(in, block);
+        std::string_view remaining(block);
+        return scan_fields_into(remaining, fields, projection);
     }
 
     [[nodiscard]] auto read_version(std::istream &in, std::string &version)
         -> std::optional<Invalid_Version>
     {
         std::string_view prefix = "WARC/";
-        std::string line{};
+        thread_local std::string line{};
         if (not std::getline(in, line)) {
-            return Invalid_Version{std::move(line)};
+            return Invalid_Version{line};
+        }
+        auto trimmed = trim_view(line);
+        if (trimmed.size() < 6 or trimmed.substr(0, prefix.size()) != prefix) {
+            return Invalid_Version{line};
+        }
+        trimmed.remove_prefix(prefix.size());
+        version.assign(trimmed.data(), trimmed.size());
+        return std::nullopt;
+    }
+
+    [[nodiscard]] inline auto read_version(std::string_view &in, std::string_view &version)
+        -> std::optional<Invalid_Version>
+    {
+        std::string_view prefix = "WARC/";
+        if (in.empty()) {
+            return Invalid_Version{};
         }
-        auto trimmed = trim(line);
-        if (trimmed.size() < 6 or std::string_view(&trimmed[0], prefix.size()) != prefix) {
-            return Invalid_Version{std::move(line)};
+        auto line = next_line(in);
+        auto trimmed = trim_view(line);
+        if (trimmed.size() < 6 or trimmed.substr(0, prefix.size()) != prefix) {
+            return Invalid_Version{std::string(line)};
         }
-        version = std::string(std::next(trimmed.begin(), prefix.size()), trimmed.end());
+        version = trimmed.substr(prefix.size());
         return std::nullopt;
     }
 
+    /**
+     * Skips to the next line starting with `WARC/` (after optional whitespace)
+     * and reads its version. Junk lines are passed over by searching the stream
+     * buffer for line ends with `std::istream::ignore`, which neither copies
+     * nor allocates. Returns `false` at the end of the stream.
+     */
+    [[nodiscard]] inline auto find_version(std::istream &in, std::string &version) -> bool
+    {
+        constexpr std::string_view prefix = "WARC/";
+        constexpr auto eof = std::char_traits<char>::eof();
+        std::istream::sentry sentry(in, true);
+        if (not sentry) {
+            return false;
+        }
+        auto *buffer = in.rdbuf();
+        while (true) {
+            auto c = buffer->sgetc();
+            while (c != eof && is_space(static_cast<char>(c))) {
+                c = buffer->snextc();
+            }
+            std::size_t matched = 0;
+            while (matched < prefix.size() && c == prefix[matched]) {
+                ++matched;
+                c = buffer->snextc();
+            }
+            if (c == eof) {
+                in.setstate(std::ios::eofbit);
+                return false;
+            }
+            if (matched == prefix.size()) {
+                std::getline(in, version);
+                while (not version.empty() && is_space(version.back())) {
+                    version.pop_back();
+                }
+                if (not version.empty()) {
+                    return true;
+                }
+            } else {
+                in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+        }
+    }
+
+    /// Same as `find_version(std::istream&, std::string&)` for a buffer; advances `in`.
+    [[nodiscard]] inline auto find_version(std::string_view &in, std::string_view &version) noexcept
+        -> bool
+    {
+        constexpr std::string_view prefix = "WARC/";
+        while (true) {
+            while (not in.empty() && is_space(in.front())) {
+                in.remove_prefix(1);
+            }
+            if (in.empty()) {
+                return false;
+            }
+            bool candidate = in.substr(0, prefix.size()) == prefix;
+            auto line = next_line(in);
+            if (candidate) {
+                version = line.substr(prefix.size());
+                while (not version.empty() && is_space(version.back())) {
+                    version.remove_suffix(1);
+                }
+                if (not version.empty()) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] inline auto read_fields(std::string_view &in,
+                                          View_Field_Map &fields,
+                                          Projection const &projection = {})
+        -> std::optional<Invalid_Field>
+    {
+        return scan_fields_into(in, fields, projection);
+    }
+
+    /// Parses a 64-bit content length; like `std::stoi`, ignores anything after the digits.
+    [[nodiscard]] inline auto parse_length(std::string_view value) -> std::uint64_t
+    {
+        std::uint64_t length = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+        if (ec != std::errc()) {
+            std::ostringstream os;
+            os << "could not parse content length: " << value;
+            throw std::runtime_error(os.str());
+        }
+        return length;
+    }
+
+    /// Appends `value` as 8 little-endian bytes; used by the binary file formats.
+    inline void put_u64(std::string &output, std::uint64_t value)
+    {
+        for (int shift = 0; shift < 64; shift += 8) {
+            output.push_back(static_cast<char>((value >> static_cast<unsigned>(shift)) & 0xFFU));
+        }
+    }
+
+    [[nodiscard]] inline auto get_u64(char const *data) noexcept -> std::uint64_t
+    {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 8) {
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(*data++))
+                     << static_cast<unsigned>(shift);
+        }
+        return value;
+    }
+
 }; // namespace detail
 
+namespace detail {
+
+    [[nodiscard]] inline auto read_header(std::istream &in,
+                                          Record &record,
+                                          Projection const &projection,
+                                          bool skip_junk) -> std::optional<Error>;
+    [[nodiscard]] inline auto read_content(std::istream &in, Record &record)
+        -> std::optional<Error>;
+
+} // namespace detail
+
 class Record {
    private:
     std::string version_;
     detail::Field_Map fields_;
     std::string content_;
 
-    static std::string const Warc_Type;
-    static std::string const Warc_Target_Uri;
-    static std::string const Warc_Trec_Id;
-    static std::string const Warc_Record_Id;
-    static std::string const Content_Length;
-    static std::string const Response;
-
    public:
     Record() = default;
     explicit Record(std::string version) : version_(std::move(version)) {}
-    [[nodiscard]] auto type() const -> std::string const & { return fields_.at(Warc_Type); }
+    explicit Record(Record_View const &view);
+    [[nodiscard]] auto version() const noexcept -> std::string const & { return version_; }
+    [[nodiscard]] auto fields() const noexcept -> detail::Field_Map const & { return fields_; }
+    [[nodiscard]] auto type() const -> std::string const & { return fields_.at(Field::Warc_Type); }
+    [[nodiscard]] auto has(Field field) const noexcept -> bool { return fields_.has(field); }
     [[nodiscard]] auto has(std::string const &field) const noexcept -> bool
     {
-        return fields_.find(field) != fields_.end();
+        return fields_.find(field) != nullptr;
     }
     [[nodiscard]] auto valid() const noexcept -> bool
     {
-        return has(Warc_Type) && has(Content_Length);
+        return has(Field::Warc_Type) && has(Field::Content_Length);
     }
     [[nodiscard]] auto valid_response() const noexcept -> bool
     {
-        return valid() && has(Warc_Target_Uri) && type() == Response && (has(Warc_Trec_Id) || has(Warc_Record_Id));
+        return valid() && has(Field::Warc_Target_Uri) && type() == "response" &&
+               (has(Field::Warc_Trec_Id) || has(Field::Warc_Record_Id));
     }
-    [[nodiscard]] auto content_length() const -> std::size_t
+    [[nodiscard]] auto content_length() const -> std::uint64_t
     {
-        auto &field_value = fields_.at(Content_Length);
-        try {
-            return std::stoi(field_value);
-        } catch (std::invalid_argument &error) {
-            std::ostringstream os;
-            os << "could not parse content length: " << field_value;
-            throw std::runtime_error(os.str());
-        }
+        return detail::parse_length(fields_.at(Field::Content_Length));
     }
     [[nodiscard]] auto content() -> std::string && { return std::move(content_); }
     [[nodiscard]] auto content() const -> std::string const & { return content_; }
-    [[nodiscard]] auto url() const -> std::string const & { return fields_.at(Warc_Target_Uri); }
-    [[nodiscard]] auto url() -> std::string && { return std::move(fields_.at(Warc_Target_Uri)); }
-    [[nodiscard]] auto trecid() const -> std::string const & { return fields_.at(Warc_Trec_Id); }
-    [[nodiscard]] auto trecid() -> std::string && { return std::move(fields_.at(Warc_Trec_Id)); }
-    [[nodiscard]] auto recordid() const -> std::string const & { return fields_.at(Warc_Record_Id); }
-    [[nodiscard]] auto recordid() -> std::string && { return std::move(fields_.at(Warc_Record_Id)); }
+    [[nodiscard]] auto url() const -> std::string const & { return fields_.at(Field::Warc_Target_Uri); }
+    [[nodiscard]] auto url() -> std::string && { return std::move(fields_.at(Field::Warc_Target_Uri)); }
+    [[nodiscard]] auto trecid() const -> std::string const & { return fields_.at(Field::Warc_Trec_Id); }
+    [[nodiscard]] auto trecid() -> std::string && { return std::move(fields_.at(Field::Warc_Trec_Id)); }
+    [[nodiscard]] auto recordid() const -> std::string const & { return fields_.at(Field::Warc_Record_Id); }
+    [[nodiscard]] auto recordid() -> std::string && { return std::move(fields_.at(Field::Warc_Record_Id)); }
 
     [[nodiscard]] auto field(std::string const &name) const -> std::optional<std::string>
     {
-        if (auto pos = fields_.find(name); pos != fields_.end()) {
-            return pos->second;
+        if (auto *value = fields_.find(name); value != nullptr) {
+            return *value;
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] auto field(Field field) const -> std::optional<std::string>
+    {
+        if (auto *value = fields_.get(field); value != nullptr) {
+            return *value;
         }
         return std::nullopt;
     }
 
     [[nodiscard]] auto has_trecid() const -> bool {
-        return has(Warc_Trec_Id);
+        return has(Field::Warc_Trec_Id);
     }
 
     [[nodiscard]] auto has_recordid() const -> bool {
-        return has(Warc_Record_Id);
+        return has(Field::Warc_Record_Id);
     }
 
-    friend auto read_record(std::istream &in) -> Result;
-    friend auto read_subsequent_record(std::istream &in) -> Result;
+    friend auto read_record(std::istream &in, Record &record, Projection const &projection)
+        -> std::optional<Error>;
+    friend auto read_subsequent_record(std::istream &in,
+                                       Record &record,
+                                       Projection const &projection) -> std::optional<Error>;
+    friend auto detail::read_header(std::istream &in,
+                                    Record &record,
+                                    Projection const &projection,
+                                    bool skip_junk) -> std::optional<Error>;
+    friend auto detail::read_content(std::istream &in, Record &record) -> std::optional<Error>;
+    friend class Record_Reader;
     friend std::ostream &operator<<(std::ostream &os, Record const &record);
 };
 
@@ -215,14 +934,92 @@ auto match(Error const &error,
 
 constexpr bool holds_record(Result const &result) { return std::holds_alternative<Record>(result); }
 
-std::string const Record::Warc_Type = "warc-type";
-std::string const Record::Warc_Target_Uri = "warc-target-uri";
-std::string const Record::Warc_Trec_Id = "warc-trec-id";
-std::string const Record::Warc_Record_Id = "warc-record-id";
-std::string const Record::Content_Length = "content-length";
-std::string const Record::Response = "response";
+namespace detail {
+
+    /**
+     * Reads the version line and the fields of a record, leaving its content
+     * in the stream. If `skip_junk` is `true`, lines preceding the version
+     * line are skipped.
+     */
+    [[nodiscard]] inline auto read_header(std::istream &in,
+                                          Record &record,
+                                          Projection const &projection,
+                                          bool skip_junk) -> std::optional<Error>
+    {
+        record.fields_.clear();
+        record.content_.clear();
+        if (skip_junk) {
+            if (not find_version(in, record.version_)) {
+                return Error(Invalid_Version{});
+            }
+        } else if (auto error = read_version(in, record.version_); error) {
+            return Error(std::move(*error));
+        }
+        if (auto error = read_fields(in, record.fields_, projection); error) {
+            return Error(std::move(*error));
+        }
+        if (not record.valid()) {
+            return Error(Missing_Mandatory_Fields{});
+        }
+        return std::nullopt;
+    }
+
+    /// Reads the content of a record whose header has just been read.
+    [[nodiscard]] inline auto read_content(std::istream &in, Record &record)
+        -> std::optional<Error>
+    {
+        auto length = record.content_length();
+        record.content_.resize(length);
+        if (length > 0 && not in.read(&record.content_[0], static_cast<std::streamsize>(length))) {
+            return Error(Incomplete_Record{});
+        }
+        while (std::isspace(in.peek())) { in.ignore(1); }
+        return std::nullopt;
+    }
+
+    /**
+     * Skips `count` bytes. Bytes already buffered are ignored; otherwise the
+     * stream seeks if it can, and reads and discards the data if it cannot.
+     * Returns `false` if the stream ends first.
+     */
+    inline auto skip_bytes(std::istream &in, std::uint64_t count) -> bool
+    {
+        if (count == 0) {
+            return true;
+        }
+        // Content already buffered is cheaper to ignore than to seek over,
+        // which would discard the buffer and cost a system call.
+        auto buffered = in.rdbuf()->in_avail();
+        if (buffered > 0 && count <= static_cast<std::uint64_t>(buffered)) {
+            in.ignore(static_cast<std::streamsize>(count));
+            return true;
+        }
+        if (in.tellg() != std::streampos(-1) &&
+            in.seekg(static_cast<std::streamoff>(count), std::ios::cur)) {
+            return true;
+        }
+        in.clear();
+        constexpr auto max_step =
+            static_cast<std::uint64_t>(std::numeric_limits<std::streamsize>::max());
+        while (count > 0) {
+            auto step = static_cast<std::streamsize>(std::min(count, max_step));
+            in.ignore(step);
+            if (in.gcount() < step) {
+                return false;
+            }
+            count -= static_cast<std::uint64_t>(step);
+        }
+        return true;
+    }
+
+} // namespace detail
 
 /**
+ * Reads a record into `record`, reusing its memory.
+ *
+ * The previous contents are discarded, but the strings holding the version,
+ * field values, and content keep their capacity, so once `record` has grown
+ * to fit the records in a collection, reading them does not allocate.
  *
  * 1. parse version, throw otherwise
  * 2. parse header and skip one CRLF
@@ -231,62 +1028,688 @@ std::string const Record::Response = "response";
  * 5. done
  *
  */
+[[nodiscard]] auto read_record(std::istream &in, Record &record, Projection const &projection = {})
+    -> std::optional<Error>
+{
+    if (auto error = detail::read_header(in, record, projection, false); error) {
+        return error;
+    }
+    return detail::read_content(in, record);
+}
+
+/// Same as `read_record(std::istream&, Record&)` but skips any junk before the version line.
+[[nodiscard]] auto read_subsequent_record(std::istream &in,
+                                          Record &record,
+                                          Projection const &projection = {})
+    -> std::optional<Error>
+{
+    if (auto error = detail::read_header(in, record, projection, true); error) {
+        return error;
+    }
+    return detail::read_content(in, record);
+}
+
 [[nodiscard]] auto read_record(std::istream &in) -> Result
 {
     Record record;
-    if (auto error = detail::read_version(in, record.version_); error) {
-        return Result(*error);
+    if (auto error = read_record(in, record); error) {
+        return Result(std::move(*error));
+    }
+    return Result(std::move(record));
+}
+
+[[nodiscard]] auto read_subsequent_record(std::istream &in) -> Result
+{
+    Record record;
+    if (auto error = read_subsequent_record(in, record); error) {
+        return Result(std::move(*error));
+    }
+    return Result(std::move(record));
+}
+
+namespace detail {
+
+    /// Returns the host of an absolute URL, e.g., `example.com` for `http://user@example.com:80/`.
+    [[nodiscard]] inline auto url_host(std::string_view url) noexcept -> std::string_view
+    {
+        auto scheme_end = url.find("://");
+        if (scheme_end == std::string_view::npos) {
+            return {};
+        }
+        auto authority = url.substr(scheme_end + 3);
+        authority = authority.substr(0, authority.find_first_of("/?#"));
+        if (auto at = authority.rfind('@'); at != std::string_view::npos) {
+            authority.remove_prefix(at + 1);
+        }
+        // A colon inside brackets belongs to an IPv6 address, not to a port.
+        if (auto colon = authority.rfind(':'); colon != std::string_view::npos &&
+                                               authority.find(']', colon) == std::string_view::npos) {
+            authority = authority.substr(0, colon);
+        }
+        return authority;
+    }
+
+} // namespace detail
+
+/**
+ * Predicate on record headers, evaluated right after the header block is
+ * parsed, before the content is read. Records rejected by a filter have
+ * their content skipped, by seeking if the stream supports it.
+ *
+ * A default-constructed filter accepts all records; each configured
+ * condition must hold for a record to be accepted.
+ */
+class Record_Filter {
+   private:
+    std::vector<std::string> types_{};
+    std::vector<std::string> url_prefixes_{};
+    std::vector<std::string> hosts_{};
+    std::function<bool(Record const &)> predicate_{};
+
+   public:
+    /// Accepts only records whose `WARC-Type` is one of `types`.
+    auto types(std::vector<std::string> types) -> Record_Filter &
+    {
+        types_ = std::move(types);
+        return *this;
     }
-    if (auto error = detail::read_fields(in, record.fields_); error) {
-        return Result(*error);
+
+    /// Accepts only records whose `WARC-Target-URI` starts with one of `prefixes`.
+    auto url_prefixes(std::vector<std::string> prefixes) -> Record_Filter &
+    {
+        url_prefixes_ = std::move(prefixes);
+        return *this;
+    }
+
+    /// Accepts only records whose target URI host is one of `hosts` (ignoring case).
+    auto hosts(std::vector<std::string> hosts) -> Record_Filter &
+    {
+        hosts_ = std::move(hosts);
+        return *this;
     }
-    if (not record.valid()) {
-        return Result(Missing_Mandatory_Fields{});
+
+    /**
+     * Accepts only records satisfying `predicate`, which is called with
+     * a record holding the projected fields and no content yet.
+     */
+    auto where(std::function<bool(Record const &)> predicate) -> Record_Filter &
+    {
+        predicate_ = std::move(predicate);
+        return *this;
     }
-    if (record.content_length() > 0) {
-        std::size_t length = record.content_length();
-        record.content_.resize(length);
-        if (not in.read(&record.content_[0], length)) {
-            return Result(Incomplete_Record{});
+
+    /// Returns `projection` extended with the fields checked by type and URL conditions.
+    [[nodiscard]] auto extend(Projection projection) const noexcept -> Projection
+    {
+        if (not url_prefixes_.empty() || not hosts_.empty()) {
+            projection = projection.with(Field::Warc_Target_Uri);
         }
+        return projection;
+    }
+
+    [[nodiscard]] auto operator()(Record const &record) const -> bool
+    {
+        if (not types_.empty() &&
+            std::find(types_.begin(), types_.end(), record.type()) == types_.end()) {
+            return false;
+        }
+        if (not url_prefixes_.empty() || not hosts_.empty()) {
+            if (not record.has(Field::Warc_Target_Uri)) {
+                return false;
+            }
+            std::string_view url = record.url();
+            if (not url_prefixes_.empty() &&
+                std::none_of(url_prefixes_.begin(), url_prefixes_.end(), [&](auto const &prefix) {
+                    return url.substr(0, prefix.size()) == prefix;
+                })) {
+                return false;
+            }
+            auto host = detail::url_host(url);
+            if (not hosts_.empty() &&
+                std::none_of(hosts_.begin(), hosts_.end(), [&](auto const &expected) {
+                    return detail::iequals(host, expected);
+                })) {
+                return false;
+            }
+        }
+        return not predicate_ || predicate_(record);
+    }
+};
+
+/**
+ * Same as `read_subsequent_record(std::istream&, Record&)` but returns only
+ * records accepted by `filter`. The content of rejected records is skipped
+ * without being copied.
+ */
+[[nodiscard]] inline auto read_subsequent_record(std::istream &in,
+                                                  Record &record,
+                                                  Record_Filter const &filter,
+                                                  Projection const &projection = {})
+    -> std::optional<Error>
+{
+    auto extended = filter.extend(projection);
+    while (true) {
+        if (auto error = detail::read_header(in, record, extended, true); error) {
+            return error;
+        }
+        if (filter(record)) {
+            return detail::read_content(in, record);
+        }
+        if (not detail::skip_bytes(in, record.content_length())) {
+            return Error(Incomplete_Record{});
+        }
+        while (std::isspace(in.peek())) { in.ignore(1); }
     }
-    while (std::isspace(in.peek())) { in.ignore(1); }
-    return Result(record);
 }
 
-[[nodiscard]] auto read_subsequent_record(std::istream &in) -> Result
+/**
+ * Reads records from a stream with memory bounded by a configured buffer size.
+ *
+ * `next` parses only the version and fields of the next record, leaving its
+ * content in the stream. The content can then be consumed in chunks of at
+ * most `buffer_size` bytes with `read_chunk` or `read_content`. Whatever is
+ * left unread is skipped by the following call to `next`, by seeking if the
+ * stream supports it. The content of records read this way is always empty.
+ */
+class Record_Reader {
+   private:
+    std::istream *in_;
+    std::vector<char> buffer_;
+    Record_Filter filter_;
+    Projection projection_;
+    std::uint64_t remaining_ = 0;
+    bool in_content_ = false;
+    bool incomplete_ = false;
+
+    void finish_content()
+    {
+        in_content_ = false;
+        while (std::isspace(in_->peek())) { in_->ignore(1); }
+    }
+
+   public:
+    static constexpr std::size_t default_buffer_size = 1U << 16U;
+
+    explicit Record_Reader(std::istream &in,
+                           std::size_t buffer_size = default_buffer_size,
+                           Projection projection = {},
+                           Record_Filter filter = {})
+        : in_(&in),
+          buffer_(std::max<std::size_t>(buffer_size, 1)),
+          filter_(std::move(filter)),
+          projection_(filter_.extend(projection))
+    {}
+
+    /**
+     * Skips the rest of the current record and any junk after it, and reads
+     * the version and fields of the next record accepted by the filter into
+     * `record`. Rejected records are skipped without reading their content.
+     */
+    [[nodiscard]] auto next(Record &record) -> std::optional<Error>
+    {
+        do {
+            skip_content();
+            incomplete_ = false;
+            if (auto error = detail::read_header(*in_, record, projection_, true); error) {
+                return error;
+            }
+            remaining_ = record.content_length();
+            in_content_ = true;
+        } while (not filter_(record));
+        if (remaining_ == 0) {
+            finish_content();
+        }
+        return std::nullopt;
+    }
+
+    /// Number of content bytes of the current record that have not been read yet.
+    [[nodiscard]] auto remaining() const noexcept -> std::uint64_t { return remaining_; }
+
+    /**
+     * Reads the next chunk of content into the internal buffer. The returned
+     * view is valid until the next call, and is empty at the end of content.
+     */
+    [[nodiscard]] auto read_chunk() -> std::string_view
+    {
+        if (remaining_ == 0) {
+            return {};
+        }
+        auto size = static_cast<std::size_t>(std::min<std::uint64_t>(remaining_, buffer_.size()));
+        in_->read(buffer_.data(), static_cast<std::streamsize>(size));
+        auto count = static_cast<std::size_t>(in_->gcount());
+        remaining_ -= count;
+        if (count < size) {
+            remaining_ = 0;
+            incomplete_ = true;
+            in_content_ = false;
+        } else if (remaining_ == 0) {
+            finish_content();
+        }
+        return {buffer_.data(), count};
+    }
+
+    /**
+     * Calls `fn` with each remaining chunk of content. Returns `Incomplete_Record`
+     * if the stream ends before the whole content is read.
+     */
+    template <typename Fn>
+    [[nodiscard]] auto read_content(Fn &&fn) -> std::optional<Error>
+    {
+        for (auto chunk = read_chunk(); not chunk.empty(); chunk = read_chunk()) {
+            fn(chunk);
+        }
+        if (incomplete_) {
+            return Error(Incomplete_Record{});
+        }
+        return std::nullopt;
+    }
+
+    /// Skips the unread content of the current record.
+    void skip_content()
+    {
+        if (not in_content_) {
+            return;
+        }
+        if (not detail::skip_bytes(*in_, remaining_)) {
+            incomplete_ = true;
+        }
+        remaining_ = 0;
+        finish_content();
+    }
+};
+
+/**
+ * Iterates over record headers only: calls `record_handler(Record const&)`
+ * for each record (with empty content) and `error_handler(Error const&)`
+ * for each invalid one. Contents are never read: they are skipped by seeking
+ * in seekable streams, so scanning time depends on the number of records
+ * rather than on the size of the collection.
+ */
+template <typename Record_Handler, typename Error_Handler>
+void for_each_header(std::istream &in,
+                     Record_Handler &&record_handler,
+                     Error_Handler &&error_handler)
 {
+    Record_Reader reader(in);
     Record record;
-    std::optional<Invalid_Version> error;
-    while ((error = detail::read_version(in, record.version_))) {
-        if (in.eof()) {
-            return Result(Invalid_Version{});
+    while (in.peek() != EOF) {
+        if (auto error = reader.next(record); error) {
+            if (in.eof() && std::get_if<Invalid_Version>(&*error) != nullptr) {
+                break;
+            }
+            error_handler(*error);
+        } else {
+            record_handler(record);
         }
     }
-    if (auto error = detail::read_fields(in, record.fields_); error) {
-        return Result(*error);
+}
+
+namespace detail {
+
+    constexpr std::size_t scan_buffer_size = 1U << 16U;
+
+    /**
+     * Checks if a valid record starts at `offset`: its header block must be
+     * valid, and skipping `Content-Length` bytes of content must lead to
+     * the end of the stream or another version line.
+     */
+    [[nodiscard]] inline auto is_record_start(std::istream &in, std::uint64_t offset) -> bool
+    {
+        in.clear();
+        if (not in.seekg(static_cast<std::streamoff>(offset))) {
+            return false;
+        }
+        std::string version;
+        Field_Map fields;
+        if (read_version(in, version) ||
+            read_fields(in, fields, Projection({Field::Content_Length}))) {
+            return false;
+        }
+        auto const *length_field = fields.get(Field::Content_Length);
+        if (length_field == nullptr || not fields.has(Field::Warc_Type)) {
+            return false;
+        }
+        std::uint64_t length = 0;
+        auto const &value = *length_field;
+        if (auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+            ec != std::errc() || ptr != value.data() + value.size()) {
+            return false;
+        }
+        if (not in.seekg(static_cast<std::streamoff>(length), std::ios::cur)) {
+            return false;
+        }
+        while (std::isspace(in.peek())) { in.ignore(1); }
+        if (in.peek() == EOF) {
+            in.clear();
+            return true;
+        }
+        char prefix[5];
+        return in.read(prefix, sizeof(prefix)) && std::string_view(prefix, 5) == "WARC/";
     }
-    if (not record.valid()) {
-        return Result(Missing_Mandatory_Fields{});
+
+    /// Finds the offset of the first line starting with `WARC/` at or after `offset`.
+    [[nodiscard]] inline auto find_version_line(std::istream &in, std::uint64_t offset)
+        -> std::optional<std::uint64_t>
+    {
+        std::string_view pattern = "\nWARC/";
+        std::string buffer(scan_buffer_size, '\0');
+        in.clear();
+        if (offset == 0) {
+            if (in.seekg(0) && in.read(&buffer[0], 5) && buffer.compare(0, 5, "WARC/") == 0) {
+                return 0;
+            }
+            in.clear();
+        }
+        // Include the preceding byte to check that the line starts at `offset`.
+        std::uint64_t base = offset > 0 ? offset - 1 : 0;
+        if (not in.seekg(static_cast<std::streamoff>(base))) {
+            return std::nullopt;
+        }
+        while (true) {
+            in.read(&buffer[0], static_cast<std::streamsize>(buffer.size()));
+            auto count = static_cast<std::size_t>(in.gcount());
+            std::string_view chunk(buffer.data(), count);
+            if (auto pos = chunk.find(pattern); pos != std::string_view::npos) {
+                return base + pos + 1;
+            }
+            if (count < pattern.size() || in.eof()) {
+                return std::nullopt;
+            }
+            // Overlap chunks by the pattern length so matches are not split.
+            base += count - pattern.size() + 1;
+            in.seekg(static_cast<std::streamoff>(base));
+        }
     }
-    if (record.content_length() > 0) {
-        std::size_t length = record.content_length();
-        record.content_.resize(length);
-        if (not in.read(&record.content_[0], length)) {
-            return Result(Incomplete_Record{});
+
+} // namespace detail
+
+/**
+ * Positions `in` at the first valid record that starts at or after `offset`,
+ * and returns its offset, or `std::nullopt` if there is none.
+ *
+ * A candidate is a line starting with `WARC/`, validated by
+ * `detail::is_record_start`, which makes it very unlikely to mistake
+ * a version line embedded in the content of another record for a record.
+ * Only a complete record embedded verbatim at the very end of another
+ * record's content passes as a real one. The stream must be seekable.
+ */
+[[nodiscard]] inline auto seek_record(std::istream &in, std::uint64_t offset)
+    -> std::optional<std::uint64_t>
+{
+    auto candidate = detail::find_version_line(in, offset);
+    while (candidate && not detail::is_record_start(in, *candidate)) {
+        candidate = detail::find_version_line(in, *candidate + 1);
+    }
+    in.clear();
+    if (not candidate) {
+        in.seekg(0, std::ios::end);
+        return std::nullopt;
+    }
+    in.seekg(static_cast<std::streamoff>(*candidate));
+    return candidate;
+}
+
+/**
+ * Reads all records starting in the byte range `[begin, end)` of a seekable
+ * stream, and calls `fn` with each `Result`.
+ *
+ * Reading starts at the first valid record at or after `begin` and may go past
+ * `end` to finish the last record. Therefore, splitting a file into adjacent
+ * ranges and reading each (possibly on different machines) yields every record
+ * exactly once. After an invalid record, reading resumes at the next valid one.
+ */
+template <typename Fn>
+void read_range(std::istream &in, std::uint64_t begin, std::uint64_t end, Fn &&fn)
+{
+    auto offset = seek_record(in, begin);
+    while (offset && *offset < end) {
+        auto result = read_record(in);
+        bool valid = holds_record(result);
+        fn(std::move(result));
+        if (valid && in.peek() != EOF) {
+            offset = static_cast<std::uint64_t>(in.tellg());
+        } else if (valid) {
+            break;
+        } else {
+            offset = seek_record(in, *offset + 1);
+        }
+    }
+}
+
+/// Splits `[0, size)` into `count` adjacent byte ranges of (almost) equal length.
+[[nodiscard]] inline auto split_ranges(std::uint64_t size, std::size_t count)
+    -> std::vector<std::pair<std::uint64_t, std::uint64_t>>
+{
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        ranges.emplace_back(size * idx / count, size * (idx + 1) / count);
+    }
+    return ranges;
+}
+
+/**
+ * Non-owning counterpart of `Record`.
+ *
+ * Version, field names, field values, and content are views into the buffer
+ * the record was parsed from (typically a `Mapped_File`), so the buffer must
+ * outlive the view. Field names are kept as they appear in the file, therefore
+ * lookups are case-insensitive. Once a view is reused for another record,
+ * only the capacity of its field storage is retained.
+ */
+class Record_View {
+   private:
+    std::string_view version_;
+    detail::View_Field_Map fields_;
+    std::string_view content_;
+
+   public:
+    [[nodiscard]] auto version() const noexcept -> std::string_view { return version_; }
+    [[nodiscard]] auto fields() const noexcept -> detail::View_Field_Map const & { return fields_; }
+    [[nodiscard]] auto field(std::string_view name) const noexcept
+        -> std::optional<std::string_view>
+    {
+        if (auto *value = fields_.find(name); value != nullptr) {
+            return *value;
+        }
+        return std::nullopt;
+    }
+    [[nodiscard]] auto field(Field field) const noexcept -> std::optional<std::string_view>
+    {
+        if (auto *value = fields_.get(field); value != nullptr) {
+            return *value;
+        }
+        return std::nullopt;
+    }
+    [[nodiscard]] auto has(Field field) const noexcept -> bool { return fields_.has(field); }
+    [[nodiscard]] auto has(std::string_view name) const noexcept -> bool
+    {
+        return fields_.find(name) != nullptr;
+    }
+    [[nodiscard]] auto valid() const noexcept -> bool
+    {
+        return has(Field::Warc_Type) && has(Field::Content_Length);
+    }
+    [[nodiscard]] auto valid_response() const noexcept -> bool
+    {
+        return valid() && has(Field::Warc_Target_Uri) && type() == "response" &&
+               (has(Field::Warc_Trec_Id) || has(Field::Warc_Record_Id));
+    }
+    [[nodiscard]] auto type() const -> std::string_view { return fields_.at(Field::Warc_Type); }
+    [[nodiscard]] auto url() const -> std::string_view
+    {
+        return fields_.at(Field::Warc_Target_Uri);
+    }
+    [[nodiscard]] auto trecid() const -> std::string_view
+    {
+        return fields_.at(Field::Warc_Trec_Id);
+    }
+    [[nodiscard]] auto recordid() const -> std::string_view
+    {
+        return fields_.at(Field::Warc_Record_Id);
+    }
+    [[nodiscard]] auto content_length() const -> std::uint64_t
+    {
+        return detail::parse_length(fields_.at(Field::Content_Length));
+    }
+    [[nodiscard]] auto content() const noexcept -> std::string_view { return content_; }
+    [[nodiscard]] auto has_trecid() const noexcept -> bool { return has(Field::Warc_Trec_Id); }
+    [[nodiscard]] auto has_recordid() const noexcept -> bool { return has(Field::Warc_Record_Id); }
+
+    friend auto read_record(std::string_view &in,
+                            Record_View &record,
+                            Projection const &projection) -> std::optional<Error>;
+    friend auto read_subsequent_record(std::string_view &in,
+                                       Record_View &record,
+                                       Projection const &projection) -> std::optional<Error>;
+};
+
+namespace detail {
+
+    [[nodiscard]] inline auto read_body(std::string_view &in,
+                                        Record_View &record,
+                                        std::string_view &content) -> std::optional<Error>
+    {
+        if (not record.valid()) {
+            return Error(Missing_Mandatory_Fields{});
+        }
+        auto length = record.content_length();
+        if (length > in.size()) {
+            in.remove_prefix(in.size());
+            return Error(Incomplete_Record{});
         }
+        content = in.substr(0, length);
+        in.remove_prefix(length);
+        while (not in.empty() && is_space(in.front())) {
+            in.remove_prefix(1);
+        }
+        return std::nullopt;
     }
-    while (std::isspace(in.peek())) { in.ignore(1); }
-    return Result(record);
+
+} // namespace detail
+
+/**
+ * Parses a record from the beginning of `in` into `record`, and advances `in`
+ * past the record. Nothing is copied or allocated, except for growing
+ * the field list of a fresh `record`. The content itself is never accessed
+ * (only the bytes following it are), so reading headers of a mapped file
+ * does not touch the pages holding large contents.
+ */
+[[nodiscard]] inline auto read_record(std::string_view &in,
+                                      Record_View &record,
+                                      Projection const &projection = {})
+    -> std::optional<Error>
+{
+    record.fields_.clear();
+    record.content_ = {};
+    if (auto error = detail::read_version(in, record.version_); error) {
+        return Error(*error);
+    }
+    if (auto error = detail::read_fields(in, record.fields_, projection); error) {
+        return Error(*error);
+    }
+    return detail::read_body(in, record, record.content_);
 }
 
+/// Same as `read_record` but skips any junk before the first version line.
+[[nodiscard]] inline auto read_subsequent_record(std::string_view &in,
+                                                  Record_View &record,
+                                                  Projection const &projection = {})
+    -> std::optional<Error>
+{
+    record.fields_.clear();
+    record.content_ = {};
+    if (not detail::find_version(in, record.version_)) {
+        return Error(Invalid_Version{});
+    }
+    if (auto error = detail::read_fields(in, record.fields_, projection); error) {
+        return Error(*error);
+    }
+    return detail::read_body(in, record, record.content_);
+}
+
+/// Copies the data of a view into an owning record.
+inline Record::Record(Record_View const &view)
+    : version_(view.version()), content_(view.content())
+{
+    view.fields().for_each([&](std::string_view name, std::string_view value) {
+        fields_[name].assign(value.data(), value.size());
+    });
+}
+
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * Throws `std::runtime_error` if the file cannot be opened or mapped.
+ */
+class Mapped_File {
+   private:
+    void *data_ = nullptr;
+    std::size_t size_ = 0;
+
+   public:
+    /**
+     * How the mapping will be accessed. `Random` disables kernel read-ahead,
+     * which is preferable when scanning headers only, so that pages holding
+     * record contents are never read from disk.
+     */
+    enum class Access { Sequential, Random };
+
+    Mapped_File() = default;
+    explicit Mapped_File(std::string const &path, Access access = Access::Sequential)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("could not open file: " + path);
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("could not stat file: " + path);
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data_ == MAP_FAILED) {
+                data_ = nullptr;
+                ::close(fd);
+                throw std::runtime_error("could not map file: " + path);
+            }
+            ::madvise(data_, size_, access == Access::Random ? MADV_RANDOM : MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+    Mapped_File(Mapped_File const &) = delete;
+    Mapped_File &operator=(Mapped_File const &) = delete;
+    Mapped_File(Mapped_File &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+    {}
+    Mapped_File &operator=(Mapped_File &&other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+    ~Mapped_File()
+    {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    [[nodiscard]] auto data() const noexcept -> std::string_view
+    {
+        return {static_cast<char const *>(data_), size_};
+    }
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return size_; }
+};
+
 std::ostream &operator<<(std::ostream &os, Record const &record)
 {
     os << "Record {";
     os << "\t" << record.version_ << "\n";
-    for (auto &&[name, value] : record.fields_) {
+    record.fields_.for_each([&](std::string_view name, std::string const &value) {
         os << "\t" << name << ": " << value << "\n";
-    }
+    });
     return os << "}";
 }
 
@@ -1,9 +1,37 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glob.h>
+#include <unistd.h>
 
 #include <CLI/CLI.hpp>
 
+#include <warcpp/columnar.hpp>
+#include <warcpp/dedup.hpp>
+#include <warcpp/digest.hpp>
+#include <warcpp/format.hpp>
+#include <warcpp/gzip.hpp>
+#include <warcpp/html.hpp>
+#include <warcpp/http.hpp>
+#include <warcpp/near_dup.hpp>
+#include <warcpp/parallel.hpp>
 #include <warcpp/warcpp.hpp>
 
 using warcpp::Error;
@@ -12,66 +40,725 @@ using warcpp::match;
 using warcpp::Record;
 using warcpp::Result;
 
-template <class Fn>
-void read(std::istream &is, Fn print_record)
+namespace fs = std::filesystem;
+
+using Format_Fn = std::function<void(Record const &, std::string &)>;
+
+/// Fields needed by the text output formats; other fields are not stored.
+constexpr warcpp::Projection text_projection{warcpp::Field::Warc_Target_Uri,
+                                             warcpp::Field::Warc_Trec_Id,
+                                             warcpp::Field::Warc_Record_Id,
+                                             warcpp::Field::Warc_Date};
+
+/**
+ * Text of the HTTP response in `record` for `--text`: the decoded body with
+ * markup removed for HTML, as it is for other text types, and empty otherwise.
+ * The result is valid until the next call on the same thread.
+ */
+[[nodiscard]] auto extract_text(Record const &record) -> std::string_view
+{
+    thread_local warcpp::Http_Body_Decoder decoder;
+    thread_local std::string text;
+    text.clear();
+    warcpp::Http_View http;
+    if (not warcpp::read_http_response(record.content(), http)) {
+        return text;
+    }
+    auto body = decoder.decode(http);
+    if (not body) {
+        return text;
+    }
+    auto const *type = http.get(warcpp::Http_Header::Content_Type);
+    auto has_type = [&](std::string_view prefix) {
+        return type != nullptr && warcpp::detail::iequals(type->substr(0, prefix.size()), prefix);
+    };
+    if (type == nullptr || has_type("text/html") || has_type("application/xhtml")) {
+        warcpp::html_to_text(*body, text);
+    } else if (has_type("text/")) {
+        text.assign(body->data(), body->size());
+    }
+    return text;
+}
+
+/// Content written for `record`: the whole HTTP response, or its text if `text` is set.
+[[nodiscard]] auto output_content(Record const &record, bool text) -> std::string_view
+{
+    return text ? extract_text(record) : std::string_view(record.content());
+}
+
+/**
+ * Drops responses whose text is similar to that of an earlier response,
+ * using MinHash signatures and a locality-sensitive hash table of bounded
+ * size. Signatures are computed on the formatting threads, and compared
+ * in input order.
+ */
+class Near_Dup_Filter {
+   private:
+    warcpp::Minhash const minhash_{};
+    std::mutex mutex_;
+    warcpp::Lsh_Table table_;
+    std::uint64_t next_id_ = 0;
+
+   public:
+    explicit Near_Dup_Filter(std::size_t memory) : table_(minhash_.bands(), memory) {}
+
+    /// Computes the band hashes of `record`, or none if it is not a response with text.
+    void bands(Record const &record, std::vector<std::uint64_t> &hashes) const
+    {
+        thread_local std::vector<std::uint32_t> signature;
+        hashes.clear();
+        if (record.type() == "response" && minhash_.signature(extract_text(record), signature)) {
+            minhash_.band_hashes(signature, hashes);
+        }
+    }
+
+    /// Returns whether the record with band hashes `hashes` is not similar to an earlier one.
+    auto admit(std::vector<std::uint64_t> const &hashes) -> bool
+    {
+        if (hashes.empty()) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto id = next_id_++;
+        return table_.insert(hashes, id) == id;
+    }
+};
+
+/// A format function with the records it reads.
+struct Output_Format {
+    Format_Fn format;
+    // By default, only responses are read, so other records are skipped before their content is.
+    warcpp::Record_Filter filter = warcpp::Record_Filter().types({"response"});
+    warcpp::Projection projection = text_projection;
+    /// If set, called on each record read, in input order; records it rejects are not formatted.
+    std::function<bool(Record const &)> keep{};
+    /// If set, records it does not admit are not written.
+    Near_Dup_Filter *near_dup = nullptr;
+};
+
+constexpr std::size_t batch_size = 256;
+constexpr std::size_t flush_size = 1U << 20U;
+
+template <class Stream>
+class Record_Source {
+   private:
+    Stream &is_;
+    Output_Format const &format_;
+
+   public:
+    Record_Source(Stream &is, Output_Format const &format) : is_(is), format_(format) {}
+
+    /// Reads the next record; returns `false` at the end of input.
+    auto next(Record &record) -> bool
+    {
+        while (not is_.eof()) {
+            auto error =
+                warcpp::read_subsequent_record(is_, record, format_.filter, format_.projection);
+            if (not error) {
+                if (format_.keep && not format_.keep(record)) {
+                    continue;
+                }
+                return true;
+            }
+            if (not is_.eof() || std::get_if<Invalid_Version>(&*error) == nullptr) {
+                std::clog << "Invalid version in line: " << *error << '\n';
+            }
+        }
+        return false;
+    }
+};
+
+struct Batch {
+    std::vector<Record> records = std::vector<Record>(batch_size);
+    std::size_t size = 0;
+    std::string output;
+    // With near-duplicate filtering, the end of the output and the band hashes of each record.
+    std::vector<std::size_t> ends = std::vector<std::size_t>(batch_size);
+    std::vector<std::vector<std::uint64_t>> bands =
+        std::vector<std::vector<std::uint64_t>>(batch_size);
+};
+
+/// Reads, formats, and writes records on the calling thread.
+template <class Stream>
+void process(Stream &is, Output_Format const &format, std::ostream &os)
 {
-    while (not is.eof()) {
-        match(
-            warcpp::read_subsequent_record(is),
-            [&](Record const &rec) { print_record(rec); },
-            [&](Error const &error) { std::clog << "Invalid version in line: " << error << '\n'; });
+    Record_Source<Stream> source(is, format);
+    Record record;
+    std::string output;
+    std::vector<std::uint64_t> bands;
+    while (source.next(record)) {
+        if (format.near_dup != nullptr) {
+            format.near_dup->bands(record, bands);
+            if (not format.near_dup->admit(bands)) {
+                continue;
+            }
+        }
+        format.format(record, output);
+        if (output.size() >= flush_size) {
+            os.write(output.data(), static_cast<std::streamsize>(output.size()));
+            output.clear();
+        }
     }
+    os.write(output.data(), static_cast<std::streamsize>(output.size()));
 }
 
-auto select_print_fn(std::string const &fmt)
-    -> std::function<std::function<void(Record const &)>(std::ostream &)>
+/**
+ * Reads and parses records on one thread, formats batches of them on
+ * `threads` threads, and writes the output in input order on the calling thread.
+ */
+template <class Stream>
+void process(Stream &is, Output_Format const &format, std::ostream &os, std::size_t threads)
 {
-    auto print_tsv = [](std::ostream &os) {
-        return [&](Record const &rec) {
-            if (rec.valid_response()) {
-                os << rec.trecid() << '\t' << rec.url() << '\t';
-                std::istringstream is(std::move(rec.content()));
-                std::string line;
-                while (std::getline(is, line)) {
-                    os << "\\u000A" << line;
+    Record_Source<Stream> source(is, format);
+    warcpp::detail::ordered_pipeline<Batch>(
+        [&](Batch &batch) {
+            batch.size = 0;
+            while (batch.size < batch.records.size() && source.next(batch.records[batch.size])) {
+                ++batch.size;
+            }
+            return batch.size > 0;
+        },
+        [&](Batch &batch) {
+            batch.output.clear();
+            for (std::size_t idx = 0; idx < batch.size; ++idx) {
+                if (format.near_dup != nullptr) {
+                    format.near_dup->bands(batch.records[idx], batch.bands[idx]);
                 }
-                os << '\n';
+                format.format(batch.records[idx], batch.output);
+                batch.ends[idx] = batch.output.size();
+            }
+        },
+        [&](Batch &batch) {
+            if (format.near_dup == nullptr) {
+                os.write(batch.output.data(), static_cast<std::streamsize>(batch.output.size()));
+                return;
+            }
+            std::size_t begin = 0;
+            for (std::size_t idx = 0; idx < batch.size; ++idx) {
+                if (format.near_dup->admit(batch.bands[idx])) {
+                    os.write(batch.output.data() + begin,
+                             static_cast<std::streamsize>(batch.ends[idx] - begin));
+                }
+                begin = batch.ends[idx];
+            }
+        },
+        threads,
+        threads * 4);
+}
+
+/// Digest verification results of the `digests` format, counted across threads.
+struct Digest_Counts {
+    std::atomic<std::size_t> checked{0};
+    std::atomic<std::size_t> failed{0};
+};
+
+[[nodiscard]] auto digest_status_name(warcpp::Digest_Status status) -> std::string_view
+{
+    switch (status) {
+    case warcpp::Digest_Status::Missing:
+        return "missing";
+    case warcpp::Digest_Status::Match:
+        return "match";
+    case warcpp::Digest_Status::Mismatch:
+        return "mismatch";
+    case warcpp::Digest_Status::Unsupported:
+        return "unsupported";
+    }
+    return "";
+}
+
+/**
+ * Verifies the block and payload digests of records of all types, and writes
+ * a line for each record with a digest that does not match or cannot be checked.
+ */
+[[nodiscard]] auto digests_format(Digest_Counts &counts) -> Output_Format
+{
+    auto format = [&counts](Record const &rec, std::string &output) {
+        auto check = warcpp::verify_digests(rec);
+        if (check.block == warcpp::Digest_Status::Missing &&
+            check.payload == warcpp::Digest_Status::Missing) {
+            return;
+        }
+        ++counts.checked;
+        auto passed = [](warcpp::Digest_Status status) {
+            return status == warcpp::Digest_Status::Match ||
+                   status == warcpp::Digest_Status::Missing;
+        };
+        if (passed(check.block) && passed(check.payload)) {
+            return;
+        }
+        ++counts.failed;
+        auto const *record_id = rec.fields().get(warcpp::Field::Warc_Record_Id);
+        warcpp::escape_tsv(record_id != nullptr ? std::string_view(*record_id) : "", output);
+        output += '\t';
+        warcpp::escape_tsv(rec.type(), output);
+        output += '\t';
+        output += digest_status_name(check.block);
+        output += '\t';
+        output += digest_status_name(check.payload);
+        output += '\n';
+    };
+    return Output_Format{format,
+                         warcpp::Record_Filter{},
+                         warcpp::Projection{warcpp::Field::Warc_Record_Id,
+                                            warcpp::Field::Content_Type,
+                                            warcpp::Field::Warc_Block_Digest,
+                                            warcpp::Field::Warc_Payload_Digest}};
+}
+
+auto select_format_fn(std::string const &fmt, bool text) -> Format_Fn
+{
+    auto format_tsv = [text](Record const &rec, std::string &output) {
+        if (rec.valid_response()) {
+            warcpp::escape_tsv(rec.trecid(), output);
+            output += '\t';
+            warcpp::escape_tsv(rec.url(), output);
+            output += '\t';
+            warcpp::escape_tsv(output_content(rec, text), output);
+            output += '\n';
+        }
+    };
+    auto format_jsonl = [text](Record const &rec, std::string &output) {
+        if (not rec.valid_response()) {
+            return;
+        }
+        char separator = '{';
+        auto add = [&](std::string_view key, auto const *value) {
+            output += separator;
+            separator = ',';
+            output += '"';
+            output += key;
+            output += "\":";
+            if (value == nullptr) {
+                output += "null";
+                return;
+            }
+            output += '"';
+            warcpp::escape_json(*value, output);
+            output += '"';
+        };
+        auto const &fields = rec.fields();
+        add("trec_id", fields.get(warcpp::Field::Warc_Trec_Id));
+        add("record_id", fields.get(warcpp::Field::Warc_Record_Id));
+        add("url", fields.get(warcpp::Field::Warc_Target_Uri));
+        add("date", fields.get(warcpp::Field::Warc_Date));
+        auto content = output_content(rec, text);
+        add("content", &content);
+        output += "}\n";
+    };
+    if (fmt == "jsonl") {
+        return format_jsonl;
+    }
+    return format_tsv;
+}
+
+/// Size of the table of seen payloads beyond which it is mapped from the spill file.
+constexpr std::size_t dedup_memory_limit = std::size_t(1) << 30U;
+
+/**
+ * Keeps the first response with each payload key (see `warcpp::payload_key`)
+ * across all inputs; other records are always kept. Valid payload digests
+ * are checked by the filter, so the content of those duplicates is skipped.
+ */
+class Deduplicator {
+   private:
+    std::mutex mutex_;
+    warcpp::Digest_Set keys_;
+
+    auto first(warcpp::Hash_128 key) -> bool
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return keys_.insert(key);
+    }
+
+    [[nodiscard]] static auto digest_key(Record const &record) -> std::optional<warcpp::Hash_128>
+    {
+        auto const *digest = record.fields().get(warcpp::Field::Warc_Payload_Digest);
+        return digest != nullptr ? warcpp::digest_key(*digest) : std::nullopt;
+    }
+
+   public:
+    explicit Deduplicator(std::string spill_path)
+        : keys_(dedup_memory_limit, std::move(spill_path))
+    {}
+
+    /// Adds the checks to `format`, which must not outlive the deduplicator.
+    void apply(Output_Format &format)
+    {
+        format.projection = format.projection.with(warcpp::Field::Warc_Payload_Digest)
+                                .with(warcpp::Field::Content_Type);
+        format.filter.where([this](Record const &record) {
+            if (record.type() != "response") {
+                return true;
             }
+            auto key = digest_key(record);
+            return not key || first(*key);
+        });
+        format.keep = [this](Record const &record) {
+            if (record.type() != "response" || digest_key(record)) {
+                return true;
+            }
+            return first(warcpp::payload_key(record));
         };
+    }
+};
+
+/// Column names of the `columns` format, in the order of `write_columns`.
+std::vector<std::string> const column_names{
+    "url", "record_id", "trec_id", "type", "date", "content"};
+
+/**
+ * Writes every record read with `format`, whatever its type, as a row;
+ * missing fields are empty.
+ * With `text`, the content of responses is their text.
+ */
+template <class Stream>
+void write_columns(Stream &is,
+                   warcpp::Column_Writer &writer,
+                   Output_Format const &format,
+                   bool text)
+{
+    Record_Source<Stream> source(is, format);
+    Record record;
+    auto field = [&](warcpp::Field field) -> std::string_view {
+        auto const *value = record.fields().get(field);
+        return value != nullptr ? std::string_view(*value) : std::string_view{};
+    };
+    std::vector<std::uint64_t> bands;
+    while (source.next(record)) {
+        if (format.near_dup != nullptr) {
+            format.near_dup->bands(record, bands);
+            if (not format.near_dup->admit(bands)) {
+                continue;
+            }
+        }
+        writer.write_row({field(warcpp::Field::Warc_Target_Uri),
+                          field(warcpp::Field::Warc_Record_Id),
+                          field(warcpp::Field::Warc_Trec_Id),
+                          record.type(),
+                          field(warcpp::Field::Warc_Date),
+                          output_content(record, text && record.type() == "response")});
+    }
+}
+
+/**
+ * Opens `input`, or the standard input if it is `-`, and calls `fn` with
+ * either the stream or a `Gzip_Istream` over it.
+ */
+template <class Fn>
+void with_input(std::string const &input, Fn fn)
+{
+    std::istream *is = &std::cin;
+    std::ifstream file;
+    if (input != "-") {
+        file.open(input, std::ios::binary);
+        if (not file) {
+            std::clog << "Cannot open " << input << '\n';
+            return;
+        }
+        is = &file;
+    }
+    if (warcpp::is_gzip(*is)) {
+        warcpp::Gzip_Istream gzip_is(*is);
+        fn(gzip_is);
+    } else {
+        fn(*is);
+    }
+}
+
+/// Processes a single input file, or the standard input if `input` is `-`.
+void process_input(std::string const &input,
+                   Output_Format const &format,
+                   std::ostream &os,
+                   std::size_t threads)
+{
+    with_input(input, [&](auto &stream) {
+        if (threads > 1) {
+            process(stream, format, os, threads);
+        } else {
+            process(stream, format, os);
+        }
+    });
+}
+
+[[nodiscard]] auto ends_with(std::string_view str, std::string_view suffix) -> bool
+{
+    return str.size() >= suffix.size() && str.substr(str.size() - suffix.size()) == suffix;
+}
+
+/**
+ * Expands glob patterns and directories (recursively, to `.warc` and
+ * `.warc.gz` files); files found in one directory or by one pattern are sorted.
+ */
+auto expand_inputs(std::vector<std::string> const &patterns) -> std::vector<std::string>
+{
+    std::vector<std::string> inputs;
+    auto add_path = [&](std::string const &path) {
+        if (path == "-" || not fs::is_directory(path)) {
+            inputs.push_back(path);
+            return;
+        }
+        std::vector<std::string> files;
+        for (auto const &entry : fs::recursive_directory_iterator(path)) {
+            auto name = entry.path().filename().string();
+            if (entry.is_regular_file() &&
+                (ends_with(name, ".warc") || ends_with(name, ".warc.gz"))) {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        inputs.insert(inputs.end(), files.begin(), files.end());
     };
-    return print_tsv;
+    for (auto const &pattern : patterns) {
+        if (pattern.find_first_of("*?[") == std::string::npos) {
+            add_path(pattern);
+            continue;
+        }
+        glob_t matches{};
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+            for (std::size_t idx = 0; idx < matches.gl_pathc; ++idx) {
+                add_path(matches.gl_pathv[idx]);
+            }
+        } else {
+            std::clog << "No files match " << pattern << '\n';
+        }
+        globfree(&matches);
+    }
+    return inputs;
+}
+
+/// Output file in `directory` for `input`: its name without `.gz` and `.warc`, plus `.<fmt>`.
+[[nodiscard]] auto shard_path(std::string const &directory,
+                              std::string const &input,
+                              std::string const &fmt) -> std::string
+{
+    std::string name = input == "-" ? "stdin" : fs::path(input).filename().string();
+    for (std::string_view suffix : {".gz", ".warc"}) {
+        if (ends_with(name, suffix)) {
+            name.resize(name.size() - suffix.size());
+        }
+    }
+    return (fs::path(directory) / (name + "." + fmt)).string();
+}
+
+[[nodiscard]] auto temporary_path() -> std::string
+{
+    auto path = (fs::temp_directory_path() / "warc-XXXXXX").string();
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        throw std::runtime_error("cannot create a temporary file");
+    }
+    close(fd);
+    return path;
+}
+
+/**
+ * Processes `inputs` concurrently, one per thread, and writes their outputs
+ * to `os` in input order. Each output is spooled to a temporary file and
+ * copied as soon as all preceding ones have been written.
+ */
+void process_concatenated(std::vector<std::string> const &inputs,
+                          Output_Format const &format,
+                          std::ostream &os,
+                          std::size_t threads)
+{
+    std::vector<std::optional<std::string>> spools(inputs.size());
+    bool finished = false;
+    std::exception_ptr error = nullptr;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::thread pool([&] {
+        try {
+            warcpp::detail::work_stealing_for(
+                inputs.size(),
+                [&](std::size_t idx) {
+                    auto path = temporary_path();
+                    {
+                        std::ofstream spool(path, std::ios::binary);
+                        process_input(inputs[idx], format, spool, 1);
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        spools[idx] = std::move(path);
+                    }
+                    ready.notify_all();
+                },
+                threads);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+        }
+        ready.notify_all();
+    });
+    for (std::size_t idx = 0; idx < inputs.size(); ++idx) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [&] { return spools[idx].has_value() || finished; });
+        if (not spools[idx]) {
+            break;
+        }
+        auto path = *spools[idx];
+        lock.unlock();
+        {
+            std::ifstream spool(path, std::ios::binary);
+            if (spool.peek() != EOF) {
+                os << spool.rdbuf();
+            }
+        }
+        std::remove(path.c_str());
+        spools[idx] = std::nullopt;
+    }
+    pool.join();
+    for (auto const &path : spools) {
+        if (path) {
+            std::remove(path->c_str());
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
 }
 
 int main(int argc, char **argv)
 {
-    std::string input;
+    std::vector<std::string> patterns;
     std::optional<std::string> output = std::nullopt;
+    std::optional<std::string> output_dir = std::nullopt;
     std::string fmt = "tsv";
+    std::size_t threads = 1;
+    bool text = false;
+    bool dedup = false;
+    std::optional<std::string> dedup_spill = std::nullopt;
+    bool near_dup = false;
+    std::size_t near_dup_memory = 1024;
     CLI::App app{
-        "Parse a WARC file and output in a selected text format.\n\n"
-        "Because lines delimit records, any new line characters in the content\n"
-        "will be replaced by \\u000A sequence."};
-    app.add_option("input", input, "Input file(s); use - to read from stdin")->required();
-    app.add_option("output", output, "Output file; if missing, write to stdout");
-    app.add_option("-f,--format", fmt, "Output file format", true)->check(CLI::IsMember({"tsv"}));
+        "Parse WARC files and output in a selected text format.\n\n"
+        "In tsv, because lines delimit records and tabs delimit columns, any new\n"
+        "line, tab, and carriage return characters are replaced by \\u000A,\n"
+        "\\u0009, and \\u000D sequences. In jsonl, each record is a JSON object\n"
+        "with trec_id, record_id, url, date, and content. In columns, records of all\n"
+        "types are written to a binary columnar file with the url, record_id,\n"
+        "trec_id, type, date, and content columns. In digests, the WARC-Block-Digest\n"
+        "and WARC-Payload-Digest (SHA-1 or SHA-256) of records of all types are\n"
+        "verified, and each record with a digest that does not match, or that cannot\n"
+        "be checked, is written as record_id, type, block status, and payload status;\n"
+        "the exit status is 2 if there is any."};
+    app.add_option("input",
+                   patterns,
+                   "Input files, directories, or glob patterns; use - to read from stdin")
+        ->required();
+    auto *output_opt = app.add_option(
+        "-o,--output", output, "Output file; if missing, write to stdout in input order");
+    auto *output_dir_opt =
+        app.add_option("-d,--output-dir",
+                       output_dir,
+                       "Write the output of each input to a file in this directory");
+    output_opt->excludes(output_dir_opt);
+    app.add_option("-f,--format", fmt, "Output file format", true)
+        ->check(CLI::IsMember({"tsv", "jsonl", "columns", "digests"}));
+    app.add_option("-j,--threads",
+                   threads,
+                   "Number of threads: inputs are processed concurrently, and a single input "
+                   "is read, formatted, and written concurrently",
+                   true);
+    app.add_flag("--text",
+                 text,
+                 "Write the text of HTTP responses (decoded, with HTML markup removed) "
+                 "instead of whole responses");
+    app.add_flag("--dedup",
+                 dedup,
+                 "Skip responses with the same payload as an earlier one, by WARC-Payload-Digest "
+                 "or, if missing, by a 128-bit hash of the payload");
+    app.add_option("--dedup-spill",
+                   dedup_spill,
+                   "With --dedup, map the table of seen payloads from this file once it exceeds "
+                   "1 GiB; the file is removed as soon as it is created");
+    app.add_flag("--near-dup",
+                 near_dup,
+                 "Skip responses whose text is similar to that of an earlier one "
+                 "(MinHash of 5-word shingles, Jaccard similarity above about 0.7)");
+    app.add_option("--near-dup-memory",
+                   near_dup_memory,
+                   "With --near-dup, size in MiB of the table of recent responses that others "
+                   "are compared with",
+                   true);
     CLI11_PARSE(app, argc, argv);
 
-    auto print = select_print_fn(fmt);
+    Digest_Counts digest_counts;
+    Output_Format format;
+    if (fmt == "digests") {
+        format = digests_format(digest_counts);
+    } else if (fmt == "columns") {
+        format = Output_Format{nullptr, warcpp::Record_Filter{}};
+    } else {
+        format = Output_Format{select_format_fn(fmt, text)};
+    }
+    std::unique_ptr<Deduplicator> deduplicator = nullptr;
+    if (dedup) {
+        deduplicator = std::make_unique<Deduplicator>(dedup_spill.value_or(""));
+        deduplicator->apply(format);
+    }
+    std::unique_ptr<Near_Dup_Filter> near_dup_filter = nullptr;
+    if (near_dup) {
+        near_dup_filter = std::make_unique<Near_Dup_Filter>(near_dup_memory << 20U);
+        format.near_dup = near_dup_filter.get();
+    }
+    auto inputs = expand_inputs(patterns);
+    threads = std::max<std::size_t>(threads, 1);
+    std::size_t input_threads = inputs.size() == 1 ? threads : 1;
 
-    std::istream *is = &std::cin;
-    std::unique_ptr<std::ifstream> file_is = nullptr;
-    if (input != "-") {
-        file_is = std::make_unique<std::ifstream>(input);
-        is = file_is.get();
+    if (output_dir) {
+        std::vector<std::string> paths;
+        for (auto const &input : inputs) {
+            paths.push_back(shard_path(*output_dir, input, fmt));
+        }
+        if (std::set<std::string>(paths.begin(), paths.end()).size() < paths.size()) {
+            std::cerr << "Inputs with the same file name would overwrite each other's output\n";
+            return 1;
+        }
+        fs::create_directories(*output_dir);
+        warcpp::detail::work_stealing_for(
+            inputs.size(),
+            [&](std::size_t idx) {
+                std::ofstream os(paths[idx], std::ios::binary);
+                if (fmt == "columns") {
+                    warcpp::Column_Writer writer(os, column_names);
+                    with_input(inputs[idx], [&](auto &stream) {
+                        write_columns(stream, writer, format, text);
+                    });
+                    writer.finish();
+                } else {
+                    process_input(inputs[idx], format, os, input_threads);
+                }
+            },
+            threads);
+        return digest_counts.failed > 0 ? 2 : 0;
     }
 
     std::ostream *os = &std::cout;
     std::unique_ptr<std::ofstream> file_os = nullptr;
     if (output) {
-        file_os = std::make_unique<std::ofstream>(*output);
+        file_os = std::make_unique<std::ofstream>(*output, std::ios::binary);
         os = file_os.get();
     }
-
-    read(*is, print(*os));
-    return 0;
+    if (fmt == "columns") {
+        // A single writer builds the footer, so inputs are read one after another.
+        warcpp::Column_Writer writer(*os, column_names);
+        for (auto const &input : inputs) {
+            with_input(input, [&](auto &stream) { write_columns(stream, writer, format, text); });
+        }
+        writer.finish();
+    } else if (inputs.size() == 1) {
+        process_input(inputs.front(), format, *os, input_threads);
+    } else {
+        process_concatenated(inputs, format, *os, threads);
+    }
+    if (fmt == "digests") {
+        os->flush();
+        std::clog << digest_counts.checked << " records with digests, " << digest_counts.failed
+                  << " failed\n";
+    }
+    return digest_counts.failed > 0 ? 2 : 0;
 }
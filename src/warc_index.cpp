@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <CLI/CLI.hpp>
+
+#include <warcpp/gzip.hpp>
+#include <warcpp/index.hpp>
+#include <warcpp/warcpp.hpp>
+
+/// Indexes `inputs` by `key` and writes the index to `output`.
+auto build(std::vector<std::string> const &inputs,
+           std::string const &output,
+           std::string const &key) -> int
+{
+    auto field =
+        key == "record_id" ? warcpp::Field::Warc_Record_Id : warcpp::Field::Warc_Target_Uri;
+    warcpp::Index_Builder builder;
+    for (auto const &input : inputs) {
+        auto file = builder.add_file(input);
+        warcpp::Mapped_File data(input);
+        builder.add_records(data.data(), file, field);
+    }
+    std::ofstream os(output, std::ios::binary);
+    builder.write(os);
+    return 0;
+}
+
+/// Writes the records with key `key` to stdout, or only their locations if `locations` is set.
+auto lookup(std::string const &index_path, std::string const &key, bool locations) -> int
+{
+    warcpp::Mapped_File data(index_path, warcpp::Mapped_File::Access::Random);
+    warcpp::Record_Index index(data.data());
+    auto [first, last] = index.equal_range(key);
+    if (first == last) {
+        std::cerr << "Key not found: " << key << '\n';
+        return 1;
+    }
+    for (auto idx = first; idx < last; ++idx) {
+        auto entry = index[idx];
+        if (locations) {
+            std::cout << entry.key << '\t' << entry.file << '\t' << entry.offset << '\t'
+                      << entry.length << '\n';
+            continue;
+        }
+        int fd = ::open(std::string(entry.file).c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Cannot open " << entry.file << '\n';
+            return 1;
+        }
+        warcpp::Record_View record;
+        auto error = warcpp::read_record_at(fd, entry.offset, entry.length, record);
+        ::close(fd);
+        if (error) {
+            std::cerr << "Cannot read " << entry.file << " at " << entry.offset << ": " << *error
+                      << '\n';
+            return 1;
+        }
+        std::cout << record.content();
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    CLI::App app{"Build and search sorted indexes mapping URLs or record IDs to WARC records."};
+    app.require_subcommand(1);
+
+    std::vector<std::string> inputs;
+    std::string output;
+    std::string key = "url";
+    auto *build_cmd = app.add_subcommand("build", "Index WARC files (plain or gzip per record)");
+    build_cmd->add_option("input", inputs, "Input files")->required();
+    build_cmd->add_option("-o,--output", output, "Index file")->required();
+    build_cmd->add_option("-k,--key", key, "Field to index by", true)
+        ->check(CLI::IsMember({"url", "record_id"}));
+
+    std::string index;
+    std::string lookup_key;
+    bool locations = false;
+    auto *lookup_cmd = app.add_subcommand("lookup", "Print the records with a given key");
+    lookup_cmd->add_option("index", index, "Index file")->required();
+    lookup_cmd->add_option("key", lookup_key, "URL or record ID")->required();
+    lookup_cmd->add_flag(
+        "-l,--locations", locations, "Print key, file, offset, and length instead of content");
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (*build_cmd) {
+        return build(inputs, output, key);
+    }
+    return lookup(index, lookup_key, locations);
+}
@@ -0,0 +1,117 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "warcpp/warcpp.hpp"
+
+using namespace warcpp;
+
+std::atomic_size_t allocation_count{0};
+
+// Not inlined, so that the compiler does not pair `malloc` with `delete` at call sites.
+[[gnu::noinline]] void *operator new(std::size_t size)
+{
+    ++allocation_count;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size); ptr != nullptr) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+std::string record(std::size_t idx)
+{
+    std::string content(100 + (idx * 37) % 1000, 'x');
+    return "WARC/1.0\r\n"
+           "WARC-Type: response\r\n"
+           "WARC-Target-URI: http://example.com/" +
+           std::to_string(idx) +
+           "\r\n"
+           "WARC-Record-ID: <urn:uuid:" +
+           std::to_string(idx) +
+           ">\r\n"
+           "X-Custom-Field: custom value\r\n"
+           "Content-Length: " +
+           std::to_string(content.size()) + "\r\n\r\n" + content + "\r\n\r\n";
+}
+
+std::string collection(std::size_t count)
+{
+    std::string output;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        output += record(idx);
+    }
+    return output;
+}
+
+TEST_CASE("Reading into a reused record does not allocate", "[warc][unit]")
+{
+    std::istringstream in(collection(200));
+    Record record;
+    for (std::size_t idx = 0; idx < 50; ++idx) {
+        REQUIRE(read_subsequent_record(in, record) == std::nullopt);
+    }
+    // Make sure the content has reached its maximal size.
+    record.content().reserve(2000);
+    auto before = allocation_count.load();
+    std::size_t count = 0;
+    while (in.peek() != EOF) {
+        REQUIRE(read_subsequent_record(in, record) == std::nullopt);
+        ++count;
+    }
+    auto allocations = allocation_count.load() - before;
+    CHECK(count == 150);
+    CHECK(allocations == 0);
+    CHECK(record.url() == "http://example.com/199");
+    CHECK(record.field("x-custom-field") == "custom value");
+}
+
+TEST_CASE("Reading record views does not allocate", "[warc][unit]")
+{
+    auto buffer = collection(200);
+    std::string_view in(buffer);
+    Record_View record;
+    REQUIRE(read_record(in, record) == std::nullopt);
+    auto before = allocation_count.load();
+    while (not in.empty()) {
+        REQUIRE(read_record(in, record) == std::nullopt);
+    }
+    CHECK(allocation_count.load() - before == 0);
+}
+
+TEST_CASE("Skipping junk does not allocate", "[warc][unit]")
+{
+    std::string junk(1U << 20U, '\x7f');
+    for (std::size_t pos = 0; pos < junk.size(); pos += 4096) {
+        junk.replace(pos, 6, "\nWARC-");
+    }
+    junk.back() = '\n';
+    std::istringstream in(record(0) + junk + record(1) + junk);
+    Record record;
+    REQUIRE(read_subsequent_record(in, record) == std::nullopt);
+    record.content().reserve(2000);
+    auto before = allocation_count.load();
+    REQUIRE(read_subsequent_record(in, record) == std::nullopt);
+    CHECK(record.url() == "http://example.com/1");
+    auto error = read_subsequent_record(in, record);
+    CHECK(allocation_count.load() - before == 0);
+    REQUIRE(error.has_value());
+    CHECK(std::get_if<Invalid_Version>(&*error) != nullptr);
+}
+
+TEST_CASE("Records are moved into results", "[warc][unit]")
+{
+    std::istringstream in(record(0));
+    auto before = allocation_count.load();
+    auto result = read_record(in);
+    REQUIRE(holds_record(result));
+    // One content and a few field values, but never a second copy of the content.
+    CHECK(allocation_count.load() - before < 10);
+}
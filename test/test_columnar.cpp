@@ -0,0 +1,103 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "warcpp/columnar.hpp"
+
+using namespace warcpp;
+
+std::string write_table(std::vector<std::vector<std::string>> const &rows,
+                        std::size_t row_group_size)
+{
+    std::ostringstream os;
+    Column_Writer writer(os, {"url", "content"}, row_group_size);
+    for (auto const &row : rows) {
+        writer.write_row({row[0], row[1]});
+    }
+    writer.finish();
+    return os.str();
+}
+
+TEST_CASE("Write and read columns", "[columnar][unit]")
+{
+    std::size_t row_group_size = GENERATE(as<std::size_t>(), 1, 100, 1U << 20U);
+    GIVEN("Row group size " << row_group_size)
+    {
+        std::vector<std::vector<std::string>> rows;
+        for (std::size_t idx = 0; idx < 50; ++idx) {
+            rows.push_back({"http://example.com/" + std::to_string(idx),
+                            idx % 7 == 0 ? std::string() : std::string(idx, '\0')});
+        }
+        auto data = write_table(rows, row_group_size);
+        Column_Reader reader(data);
+        CHECK(reader.names() == std::vector<std::string>{"url", "content"});
+        CHECK(reader.column_index("content") == 1);
+        CHECK(reader.column_index("date") == std::nullopt);
+        std::size_t row = 0;
+        for (std::size_t group = 0; group < reader.row_groups(); ++group) {
+            auto urls = reader.column(group, 0);
+            auto contents = reader.column(group, 1);
+            REQUIRE(urls.size() == reader.rows(group));
+            REQUIRE(contents.size() == reader.rows(group));
+            for (std::size_t idx = 0; idx < urls.size(); ++idx, ++row) {
+                REQUIRE(urls[idx] == rows[row][0]);
+                REQUIRE(contents[idx] == rows[row][1]);
+            }
+        }
+        CHECK(row == rows.size());
+        if (row_group_size == 1) {
+            CHECK(reader.row_groups() == rows.size());
+        }
+    }
+}
+
+TEST_CASE("Read a column without the others", "[columnar][unit]")
+{
+    auto data = write_table({{"a", "first"}, {"b", "second"}}, 1U << 20U);
+    Column_Reader reader(data);
+    REQUIRE(reader.row_groups() == 1);
+    auto content_chunk = data.find("firstsecond");
+    REQUIRE(content_chunk != std::string::npos);
+    // Overwriting the content values must not change the url column.
+    data.replace(content_chunk, 11, 11, 'x');
+    auto urls = reader.column(0, 0);
+    CHECK(urls[0] == "a");
+    CHECK(urls[1] == "b");
+    CHECK(reader.column(0, 1)[1] == "xxxxxx");
+}
+
+TEST_CASE("Write an empty table", "[columnar][unit]")
+{
+    auto data = write_table({}, 100);
+    Column_Reader reader(data);
+    CHECK(reader.names().size() == 2);
+    CHECK(reader.row_groups() == 0);
+}
+
+TEST_CASE("Reject rows of the wrong size", "[columnar][unit]")
+{
+    std::ostringstream os;
+    Column_Writer writer(os, {"url", "content"});
+    CHECK_THROWS_AS(writer.write_row({"a"}), std::invalid_argument);
+}
+
+TEST_CASE("Reject malformed columnar files", "[columnar][unit]")
+{
+    auto data = write_table({{"a", "first"}, {"b", "second"}}, 1U << 20U);
+    CHECK_THROWS_AS(Column_Reader(data.substr(0, data.size() - 1)), std::runtime_error);
+    CHECK_THROWS_AS(Column_Reader(data.substr(1)), std::runtime_error);
+    CHECK_THROWS_AS(Column_Reader("WARCCOL1"), std::runtime_error);
+    auto truncated_footer = data;
+    truncated_footer[truncated_footer.size() - 16] = '\x7f';
+    CHECK_THROWS_AS(Column_Reader(truncated_footer), std::runtime_error);
+    auto bad_offset = data;
+    // The last value offset of the url column points past its chunk.
+    bad_offset[8 + 8] = '\x7f';
+    Column_Reader reader(bad_offset);
+    CHECK_THROWS_AS(reader.column(0, 0), std::runtime_error);
+    CHECK_THROWS_AS(reader.column(0, 2), std::out_of_range);
+}
@@ -0,0 +1,104 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <unistd.h>
+
+#include "warcpp/dedup.hpp"
+
+using namespace warcpp;
+
+TEST_CASE("Hash payloads to 128 bits", "[dedup][unit]")
+{
+    std::string data(1000, 'x');
+    std::set<std::pair<std::uint64_t, std::uint64_t>> hashes;
+    for (std::size_t size = 0; size <= data.size(); ++size) {
+        auto hash = hash_128(std::string_view(data).substr(0, size));
+        CHECK(hash == hash_128(std::string(size, 'x')));
+        hashes.emplace(hash.high, hash.low);
+    }
+    CHECK(hashes.size() == data.size() + 1);
+    CHECK(hash_128("abc") != hash_128("abd"));
+    CHECK(hash_128("abc") != hash_128("abc", 1));
+    CHECK(hash_128(std::string(31, '\0')) != hash_128(std::string(32, '\0')));
+}
+
+TEST_CASE("Decode digest keys", "[dedup][unit]")
+{
+    auto key = digest_key("sha1:VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5");
+    REQUIRE(key);
+    // SHA-1("abc") = a9993e364706816aba3e25717850c26c9cd0d89d, read little-endian.
+    CHECK(key->high == 0x6a810647363e99a9ULL);
+    CHECK(key->low == 0x6cc2507871253ebaULL);
+    CHECK(digest_key("SHA1:vgmt4nsha2awvor6evyxqugcnsonbwe5") == key);
+    CHECK(digest_key("sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    CHECK_FALSE(digest_key("md5:kAFQmDzST7DWlj99KOF/cg=="));
+    CHECK_FALSE(digest_key("sha1:invalid"));
+    CHECK_FALSE(digest_key("VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5"));
+}
+
+TEST_CASE("Key records by payload", "[dedup][unit]")
+{
+    auto record = [](std::string const &fields, std::string const &block) {
+        std::istringstream in("WARC/1.0\r\nWARC-Type: response\r\n"
+                              "Content-Type: application/http; msgtype=response\r\n" +
+                              fields + "Content-Length: " + std::to_string(block.size()) +
+                              "\r\n\r\n" + block + "\r\n\r\n");
+        Record record;
+        REQUIRE_FALSE(read_record(in, record).has_value());
+        return record;
+    };
+    auto with_digest = record("WARC-Payload-Digest: sha1:VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5\r\n",
+                              "HTTP/1.1 200 OK\r\n\r\nabc");
+    CHECK(payload_key(with_digest) == *digest_key("sha1:VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5"));
+
+    // Without a digest, only the payload counts, not the HTTP headers.
+    auto first = record("", "HTTP/1.1 200 OK\r\nDate: Mon\r\n\r\nsame body");
+    auto second = record("", "HTTP/1.1 200 OK\r\nDate: Tue\r\n\r\nsame body");
+    auto other = record("", "HTTP/1.1 200 OK\r\nDate: Tue\r\n\r\nother body");
+    CHECK(payload_key(first) == hash_128("same body"));
+    CHECK(payload_key(first) == payload_key(second));
+    CHECK(payload_key(first) != payload_key(other));
+}
+
+TEST_CASE("Insert into a digest set", "[dedup][unit]")
+{
+    Digest_Set set;
+    CHECK(set.size() == 0);
+    CHECK_FALSE(set.contains(Hash_128{1, 2}));
+    CHECK(set.insert(Hash_128{1, 2}));
+    CHECK_FALSE(set.insert(Hash_128{1, 2}));
+    CHECK(set.insert(Hash_128{2, 2}));
+    CHECK(set.insert(Hash_128{0, 0}));
+    CHECK_FALSE(set.insert(Hash_128{0, 0}));
+    CHECK(set.contains(Hash_128{0, 0}));
+    CHECK(set.size() == 3);
+    CHECK_FALSE(set.spilled());
+}
+
+TEST_CASE("Spill a digest set to a file", "[dedup][unit]")
+{
+    char path[] = "/tmp/warcpp-dedup-XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    close(fd);
+
+    Digest_Set set(std::size_t(1) << 20U, path);
+    std::size_t const count = 200000;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        REQUIRE(set.insert(hash_128(std::to_string(idx))));
+    }
+    CHECK(set.spilled());
+    CHECK(set.capacity() * sizeof(Hash_128) > (std::size_t(1) << 20U));
+    CHECK(access(path, F_OK) != 0);
+    CHECK(set.size() == count);
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        REQUIRE_FALSE(set.insert(hash_128(std::to_string(idx))));
+    }
+    CHECK_FALSE(set.contains(hash_128(std::to_string(count))));
+}
@@ -0,0 +1,162 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "warcpp/digest.hpp"
+
+using namespace warcpp;
+
+template <typename Digest>
+std::string hex(Digest const &digest)
+{
+    std::string output;
+    for (auto byte : digest) {
+        output += "0123456789abcdef"[byte >> 4U];
+        output += "0123456789abcdef"[byte & 0xFU];
+    }
+    return output;
+}
+
+template <typename Hasher>
+std::string hash(std::string const &data)
+{
+    Hasher hasher;
+    hasher.update(data);
+    return hex(hasher.finish());
+}
+
+std::string const long_message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+TEST_CASE("Compute SHA-1", "[digest][unit]")
+{
+    CHECK(hash<Sha1>("") == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    CHECK(hash<Sha1>("abc") == "a9993e364706816aba3e25717850c26c9cd0d89d");
+    CHECK(hash<Sha1>(long_message) == "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+    CHECK(hash<Sha1>(std::string(1000000, 'a')) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+}
+
+TEST_CASE("Compute SHA-256", "[digest][unit]")
+{
+    CHECK(hash<Sha256>("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(hash<Sha256>("abc") ==
+          "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    CHECK(hash<Sha256>(long_message) ==
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    CHECK(hash<Sha256>(std::string(1000000, 'a')) ==
+          "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_CASE("Hash data in pieces", "[digest][unit]")
+{
+    std::mt19937 generator(7);
+    std::string data(1000, '\0');
+    for (auto &c : data) {
+        c = static_cast<char>(generator());
+    }
+    for (std::size_t size : {0, 1, 55, 56, 63, 64, 65, 127, 128, 1000}) {
+        auto prefix = data.substr(0, size);
+        Sha1 sha1;
+        Sha256 sha256;
+        for (std::size_t pos = 0; pos < size; pos += 13) {
+            sha1.update(std::string_view(prefix).substr(pos, 13));
+            sha256.update(std::string_view(prefix).substr(pos, 13));
+        }
+        CHECK(hex(sha1.finish()) == hash<Sha1>(prefix));
+        CHECK(hex(sha256.finish()) == hash<Sha256>(prefix));
+
+        // Whichever kernel was compiled, it must agree with the scalar one.
+        auto blocks = reinterpret_cast<unsigned char const *>(prefix.data());
+        auto sha1_state = detail::Sha1_Traits::initial;
+        auto sha1_expected = sha1_state;
+        detail::Sha1_Traits::compress(sha1_state, blocks, size / 64);
+        detail::sha1_compress_scalar(sha1_expected, blocks, size / 64);
+        CHECK(sha1_state == sha1_expected);
+        auto sha256_state = detail::Sha256_Traits::initial;
+        auto sha256_expected = sha256_state;
+        detail::Sha256_Traits::compress(sha256_state, blocks, size / 64);
+        detail::sha256_compress_scalar(sha256_expected, blocks, size / 64);
+        CHECK(sha256_state == sha256_expected);
+    }
+}
+
+TEST_CASE("Encode and decode digests", "[digest][unit]")
+{
+    CHECK(base32_encode("") == "");
+    CHECK(base32_encode("f") == "MY======");
+    CHECK(base32_encode("fo") == "MZXQ====");
+    CHECK(base32_encode("foobar") == "MZXW6YTBOI======");
+    CHECK(decode_digest("MZXW6YTBOI======", 6) == "foobar");
+    CHECK(decode_digest("mzxw6ytboi", 6) == "foobar");
+    CHECK(decode_digest("666f6f626172", 6) == "foobar");
+    CHECK(decode_digest("MZXW6YTBOI", 5) == std::nullopt);
+    CHECK(decode_digest("MZXW6YTBO1", 6) == std::nullopt);
+}
+
+TEST_CASE("Check digests", "[digest][unit]")
+{
+    CHECK(check_digest("sha1:VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5", "abc") == Digest_Status::Match);
+    CHECK(check_digest("SHA1:vgmt4nsha2awvor6evyxqugcnsonbwe5", "abc") == Digest_Status::Match);
+    CHECK(check_digest("sha1:a9993e364706816aba3e25717850c26c9cd0d89d", "abc") ==
+          Digest_Status::Match);
+    CHECK(check_digest("sha1:VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5", "abd") ==
+          Digest_Status::Mismatch);
+    CHECK(check_digest("sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+                       "abc") == Digest_Status::Match);
+    CHECK(check_digest("md5:kAFQmDzST7DWlj99KOF/cg==", "abc") == Digest_Status::Unsupported);
+    CHECK(check_digest("sha1:TOOSHORT", "abc") == Digest_Status::Unsupported);
+    CHECK(check_digest("VGMT4NSHA2AWVOR6EVYXQUGCNSONBWE5", "abc") == Digest_Status::Unsupported);
+}
+
+std::string warc_record(std::string const &fields, std::string const &block)
+{
+    return "WARC/1.0\r\nWARC-Type: response\r\nContent-Type: application/http; "
+           "msgtype=response\r\n" +
+           fields + "Content-Length: " + std::to_string(block.size()) + "\r\n\r\n" + block +
+           "\r\n\r\n";
+}
+
+TEST_CASE("Verify record digests", "[digest][unit]")
+{
+    std::string payload = "<html>Hello</html>";
+    std::string block = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n" + payload;
+    Sha1 block_hasher;
+    block_hasher.update(block);
+    auto block_digest = block_hasher.finish();
+    Sha1 payload_hasher;
+    payload_hasher.update(payload);
+    auto payload_digest = payload_hasher.finish();
+    auto field = [](std::string const &name, auto const &digest) {
+        std::string bytes(digest.begin(), digest.end());
+        return name + ": sha1:" + base32_encode(bytes) + "\r\n";
+    };
+
+    Record record;
+    std::istringstream in(warc_record(field("WARC-Block-Digest", block_digest) +
+                                          field("WARC-Payload-Digest", payload_digest),
+                                      block));
+    REQUIRE_FALSE(read_record(in, record).has_value());
+    auto check = verify_digests(record);
+    CHECK(check.block == Digest_Status::Match);
+    CHECK(check.payload == Digest_Status::Match);
+
+    std::istringstream swapped(warc_record(field("WARC-Block-Digest", payload_digest) +
+                                               field("WARC-Payload-Digest", block_digest),
+                                           block));
+    REQUIRE_FALSE(read_record(swapped, record).has_value());
+    check = verify_digests(record);
+    CHECK(check.block == Digest_Status::Mismatch);
+    CHECK(check.payload == Digest_Status::Mismatch);
+
+    std::istringstream missing(warc_record("", block));
+    REQUIRE_FALSE(read_record(missing, record).has_value());
+    check = verify_digests(record);
+    CHECK(check.block == Digest_Status::Missing);
+    CHECK(check.payload == Digest_Status::Missing);
+
+    CHECK(record_payload("HTTP/1.1 200 OK\nA: b\n\nbody", "application/http") == "body");
+    CHECK(record_payload("HTTP/1.1 200 OK\r\n", "application/http") == "");
+    CHECK(record_payload("plain", "text/plain") == "plain");
+}
@@ -0,0 +1,103 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <string>
+
+#include "warcpp/format.hpp"
+
+using namespace warcpp;
+
+std::string tsv(std::string const &input)
+{
+    std::string output = "prefix";
+    escape_tsv(input, output);
+    return output.substr(6);
+}
+
+TEST_CASE("Escape TSV column", "[format][unit]")
+{
+    CHECK(tsv("") == "");
+    CHECK(tsv("plain text") == "plain text");
+    CHECK(tsv("a\nb") == "a\\u000Ab");
+    CHECK(tsv("\r\n\tx\n") == "\\u000D\\u000A\\u0009x\\u000A");
+    CHECK(tsv("unicode \xc3\xa9 stays") == "unicode \xc3\xa9 stays");
+}
+
+TEST_CASE("Escape TSV column across SIMD blocks", "[format][unit]")
+{
+    for (std::size_t length = 0; length < 100; ++length) {
+        std::string input;
+        std::string expected;
+        for (std::size_t idx = 0; idx < length; ++idx) {
+            char c = "abc\ndef\tgh\r"[(idx * 7) % 11];
+            input.push_back(c);
+            expected += c == '\n'   ? "\\u000A"
+                        : c == '\t' ? "\\u0009"
+                        : c == '\r' ? "\\u000D"
+                                    : std::string(1, c);
+        }
+        REQUIRE(tsv(input) == expected);
+    }
+}
+
+std::string json(std::string const &input)
+{
+    std::string output = "prefix";
+    escape_json(input, output);
+    return output.substr(6);
+}
+
+TEST_CASE("Escape JSON string", "[format][unit]")
+{
+    CHECK(json("") == "");
+    CHECK(json("plain text") == "plain text");
+    CHECK(json("say \"hi\" \\ bye") == "say \\\"hi\\\" \\\\ bye");
+    CHECK(json("\n\r\t\b\f") == "\\n\\r\\t\\b\\f");
+    CHECK(json(std::string("\x00\x01\x1f", 3)) == "\\u0000\\u0001\\u001F");
+    CHECK(json("\x7f") == "\x7f");
+}
+
+TEST_CASE("Replace malformed UTF-8 in JSON strings", "[format][unit]")
+{
+    std::string replacement = "\xef\xbf\xbd";
+    std::string valid = "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80";
+    CHECK(json(valid) == valid);
+    CHECK(json("\xff") == replacement);
+    CHECK(json("a\xc3") == "a" + replacement);
+    CHECK(json("\xc0\xaf") == replacement + replacement);
+    CHECK(json("\xed\xa0\x80") == replacement + replacement + replacement);
+    CHECK(json("\xf4\x90\x80\x80") == replacement + replacement + replacement + replacement);
+    CHECK(json("\xe2\x82") == replacement + replacement);
+}
+
+TEST_CASE("Escape JSON string across SIMD blocks", "[format][unit]")
+{
+    for (std::size_t length = 0; length < 100; ++length) {
+        std::string input;
+        std::string expected;
+        for (std::size_t idx = 0; idx < length; ++idx) {
+            switch ((idx * 7) % 13) {
+            case 0:
+                input += '"';
+                expected += "\\\"";
+                break;
+            case 1:
+                input += '\x02';
+                expected += "\\u0002";
+                break;
+            case 2:
+                input += "\xc3\xa9";
+                expected += "\xc3\xa9";
+                break;
+            case 3:
+                input += '\x80';
+                expected += "\xef\xbf\xbd";
+                break;
+            default:
+                input += 'a';
+                expected += 'a';
+            }
+        }
+        REQUIRE(json(input) == expected);
+    }
+}
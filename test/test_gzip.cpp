@@ -0,0 +1,194 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "warcpp/gzip.hpp"
+
+using namespace warcpp;
+
+std::string gzip(std::string const &input)
+{
+    z_stream stream{};
+    REQUIRE(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) ==
+            Z_OK);
+    std::string output(deflateBound(&stream, input.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = input.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+    stream.avail_out = output.size();
+    REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+std::string record(std::string const &trecid, std::string const &content)
+{
+    return "WARC/1.0\r\n"
+           "WARC-Type: response\r\n"
+           "WARC-TREC-ID: " +
+           trecid +
+           "\r\n"
+           "WARC-Target-URI: http://example.com/" +
+           trecid +
+           "\r\n"
+           "Content-Length: " +
+           std::to_string(content.size()) + "\r\n\r\n" + content + "\r\n\r\n";
+}
+
+TEST_CASE("Detect gzip input", "[gzip][unit]")
+{
+    std::istringstream compressed(gzip("WARC/1.0\n"));
+    std::istringstream plain("WARC/1.0\n");
+    CHECK(is_gzip(compressed));
+    CHECK(not is_gzip(plain));
+}
+
+TEST_CASE("Read records from gzip members", "[gzip][unit]")
+{
+    std::size_t buffer_size = GENERATE(as<std::size_t>(), 16, 1024, 1U << 16U);
+    GIVEN("Buffer size " << buffer_size)
+    {
+        std::vector<std::string> trecids{"a", "b", "c"};
+        std::string file;
+        std::vector<std::uint64_t> offsets;
+        for (auto const &trecid : trecids) {
+            offsets.push_back(file.size());
+            file += gzip(record(trecid, "content of " + trecid + std::string(100, 'x')));
+        }
+        std::istringstream source(file);
+        Gzip_Istream in(source, buffer_size);
+        for (std::size_t idx = 0; idx < trecids.size(); ++idx) {
+            REQUIRE(in.at_member_start());
+            auto result = read_subsequent_record(in);
+            REQUIRE(holds_record(result));
+            CHECK(std::get<Record>(result).trecid() == trecids[idx]);
+            CHECK(std::get<Record>(result).content() ==
+                  "content of " + trecids[idx] + std::string(100, 'x'));
+            if (idx + 1 < trecids.size()) {
+                CHECK(in.member_offset() == offsets[idx + 1]);
+            }
+        }
+        CHECK(in.peek() == EOF);
+    }
+}
+
+TEST_CASE("Read multiple records from a single member", "[gzip][unit]")
+{
+    std::istringstream source(gzip(record("a", "first") + record("b", "second")));
+    Gzip_Istream in(source, 32);
+    auto first = read_subsequent_record(in);
+    auto second = read_subsequent_record(in);
+    REQUIRE(holds_record(first));
+    REQUIRE(holds_record(second));
+    CHECK(std::get<Record>(first).content() == "first");
+    CHECK(std::get<Record>(second).content() == "second");
+}
+
+TEST_CASE("Resynchronize at member boundaries", "[gzip][unit]")
+{
+    std::string invalid = "WARC/1.0\r\nWARC-Type: response\r\n\r\nWARC/1.0 junk\r\n";
+    std::string corrupted = gzip(record("x", "lost"));
+    corrupted[corrupted.size() / 2] ^= 0x55;
+    std::string file = gzip(record("a", "first")) + gzip(invalid) + corrupted + "garbage" +
+                       gzip(record("b", "second"));
+    std::istringstream source(file);
+    Gzip_Istream in(source, 64);
+    std::vector<std::string> trecids;
+    while (in.peek() != EOF) {
+        auto result = read_subsequent_record(in);
+        if (holds_record(result)) {
+            trecids.push_back(std::get<Record>(result).trecid());
+        }
+    }
+    CHECK(trecids == std::vector<std::string>{"a", "b"});
+}
+
+TEST_CASE("Skip content of compressed records", "[gzip][unit]")
+{
+    std::istringstream source(gzip(record("a", std::string(5000, 'a'))) +
+                              gzip(record("b", std::string(5000, 'b'))));
+    Gzip_Istream in(source, 128);
+    Record_Reader reader(in, 64);
+    Record record;
+    REQUIRE(reader.next(record) == std::nullopt);
+    CHECK(reader.read_chunk() == std::string(64, 'a'));
+    REQUIRE(reader.next(record) == std::nullopt);
+    CHECK(record.trecid() == "b");
+    CHECK(reader.remaining() == 5000);
+    CHECK(reader.next(record).has_value());
+}
+
+TEST_CASE("Filter compressed records", "[gzip][unit]")
+{
+    std::string skipped = "WARC/1.0\r\nWARC-Type: request\r\nContent-Length: 4\r\n\r\nskip\r\n\r\n";
+    std::istringstream source(gzip(skipped) + gzip(record("a", "first")) +
+                              gzip(skipped + record("b", "second")));
+    Gzip_Istream in(source, 32);
+    auto filter = Record_Filter().types({"response"});
+    Record record;
+    std::vector<std::string> contents;
+    while (not read_subsequent_record(in, record, filter)) {
+        contents.push_back(record.content());
+    }
+    CHECK(contents == std::vector<std::string>{"first", "second"});
+}
+
+TEST_CASE("Read records at member offsets", "[gzip][unit]")
+{
+    std::string plain = record("p", "plain content");
+    std::string corrupted = gzip(record("x", std::string(100, 'x')));
+    corrupted[corrupted.size() / 2] ^= 0x55;
+    std::string file = plain;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> members;
+    for (std::size_t idx = 0; idx < 100; ++idx) {
+        auto member = gzip(record(std::to_string(idx), "content " + std::to_string(idx)));
+        members.emplace_back(file.size(), member.size());
+        file += member;
+    }
+    auto corrupted_offset = file.size();
+    file += corrupted;
+    std::string path = "/tmp/warcpp-gzip-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    REQUIRE(fd >= 0);
+    REQUIRE(::write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()));
+
+    Record_View view;
+    REQUIRE(not read_record_at(fd, 0, plain.size(), view));
+    CHECK(view.trecid() == "p");
+    CHECK(view.content() == "plain content");
+    CHECK(read_record_at(fd, corrupted_offset, corrupted.size(), view).has_value());
+    CHECK(read_record_at(fd, file.size() - 10, 20, view).has_value());
+
+    std::vector<std::thread> threads;
+    std::atomic_size_t matched{0};
+    for (std::size_t thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([&, thread] {
+            Record record;
+            for (std::size_t idx = thread; idx < members.size(); idx += 4) {
+                auto [offset, length] = members[idx];
+                if (not read_record_at(fd, offset, length, record) &&
+                    record.trecid() == std::to_string(idx) &&
+                    record.content() == "content " + std::to_string(idx)) {
+                    ++matched;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK(matched == members.size());
+    ::close(fd);
+    std::remove(path.c_str());
+}
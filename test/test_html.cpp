@@ -0,0 +1,69 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <string>
+
+#include "warcpp/html.hpp"
+
+using namespace warcpp;
+
+std::string text(std::string const &html)
+{
+    std::string output = "prefix";
+    html_to_text(html, output);
+    return output.substr(6);
+}
+
+TEST_CASE("Extract text from HTML", "[html][unit]")
+{
+    CHECK(text("") == "");
+    CHECK(text("plain text") == "plain text");
+    CHECK(text("<html><head><title>Title</title></head><body><p>First</p><p>Second</p>") ==
+          "Title First Second");
+    CHECK(text("<p>bold <b>wo</b>rd and <A HREF='x'>link</A>.</p>") == "bold word and link.");
+    CHECK(text("a<br/>b<BR>c") == "a b c");
+    CHECK(text("  \n leading\t\tand \r\n trailing \n ") == "leading and trailing");
+    CHECK(text("a <!-- comment <p> --> b") == "a b");
+    CHECK(text("<!DOCTYPE html><?xml version='1.0'?>text") == "text");
+    CHECK(text("x < y > z") == "x < y > z");
+    CHECK(text("unterminated <p") == "unterminated");
+}
+
+TEST_CASE("Skip scripts and styles", "[html][unit]")
+{
+    CHECK(text("a<script>if (a < b) { x = '</p>'; }</script>b") == "a b");
+    CHECK(text("a<SCRIPT type='text/javascript'>var x;</Script >b") == "a b");
+    CHECK(text("a<style>p { color: red; }</style>b") == "a b");
+    CHECK(text("a<script>unterminated") == "a");
+    CHECK(text("<scripts>kept</scripts>") == "kept");
+}
+
+TEST_CASE("Decode HTML entities", "[html][unit]")
+{
+    CHECK(text("&lt;tag&gt; &amp; &quot;q&quot; &apos;") == "<tag> & \"q\" '");
+    CHECK(text("caf&eacute; &euro;5 &#233; &#xE9; &#X20AC;") ==
+          "caf\xc3\xa9 \xe2\x82\xac" "5 \xc3\xa9 \xc3\xa9 \xe2\x82\xac");
+    CHECK(text("a&nbsp;b &nbsp; c&#10;d") == "a b c d");
+    CHECK(text("&nbsp;x&nbsp;") == "x");
+    CHECK(text("&#0; &#xD800; &#x110000;") == "\xef\xbf\xbd \xef\xbf\xbd \xef\xbf\xbd");
+    CHECK(text("AT&T &unknown; & &#; &#xZZ;") == "AT&T &unknown; & &#; &#xZZ;");
+}
+
+TEST_CASE("Extract text across SIMD blocks", "[html][unit]")
+{
+    for (std::size_t length = 0; length < 100; ++length) {
+        std::string html;
+        std::string expected;
+        for (std::size_t idx = 0; idx < length; ++idx) {
+            auto word = std::to_string(idx);
+            html += idx % 3 == 0   ? "<p>" + word + "</p>"
+                    : idx % 3 == 1 ? word + " "
+                                   : word + "\n\n";
+            expected += word + " ";
+        }
+        if (not expected.empty()) {
+            expected.pop_back();
+        }
+        REQUIRE(text(html) == expected);
+    }
+}
@@ -0,0 +1,153 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "warcpp/http.hpp"
+
+using namespace warcpp;
+
+TEST_CASE("Look up HTTP headers by name", "[http][unit]")
+{
+    for (std::size_t idx = 0; idx < http_header_count; ++idx) {
+        auto id = static_cast<Http_Header>(idx);
+        CHECK(http_header_id(http_header_name(id)) == id);
+    }
+    CHECK(http_header_id("CONTENT-ENCODING") == Http_Header::Content_Encoding);
+    CHECK(http_header_id("content-typ") == Http_Header::Unknown);
+}
+
+TEST_CASE("Parse HTTP response", "[http][unit]")
+{
+    std::string newline = GENERATE(std::string("\r\n"), std::string("\n"));
+    std::string message = "HTTP/1.1 404 Not Found" + newline + "content-type: text/html" +
+                          newline + "X-Custom:  first " + newline + "Set-Cookie: a=1" + newline +
+                          "set-cookie: b=2" + newline + "X-Folded: one" + newline + "\ttwo" +
+                          newline + newline + "<html>body" + newline + newline + "</html>";
+    Http_View response;
+    REQUIRE(read_http_response(message, response));
+    CHECK(response.version() == "HTTP/1.1");
+    CHECK(response.status() == 404);
+    CHECK(response.reason() == "Not Found");
+    REQUIRE(response.get(Http_Header::Content_Type) != nullptr);
+    CHECK(*response.get(Http_Header::Content_Type) == "text/html");
+    CHECK(response.get(Http_Header::Content_Length) == nullptr);
+    CHECK(response.find("Content-Type") == "text/html");
+    CHECK(response.find("x-custom") == "first");
+    CHECK(response.find("Set-Cookie") == "a=1");
+    CHECK(response.find("x-folded") == "one" + newline + "\ttwo");
+    CHECK(response.find("x-missing") == std::nullopt);
+    CHECK(response.body() == "<html>body" + newline + newline + "</html>");
+    CHECK(response.body().data() == message.data() + message.find("<html>"));
+    std::vector<std::string> names;
+    response.for_each([&](std::string_view name, std::string_view) { names.emplace_back(name); });
+    CHECK(names == std::vector<std::string>{
+                       "content-type", "X-Custom", "Set-Cookie", "set-cookie", "X-Folded"});
+}
+
+TEST_CASE("Parse HTTP response without headers or body", "[http][unit]")
+{
+    Http_View response;
+    REQUIRE(read_http_response("HTTP/1.0 200\r\n\r\n", response));
+    CHECK(response.status() == 200);
+    CHECK(response.reason().empty());
+    CHECK(response.body().empty());
+}
+
+TEST_CASE("Reject malformed HTTP responses", "[http][unit]")
+{
+    Http_View response;
+    CHECK(not read_http_response("", response));
+    CHECK(not read_http_response("GET / HTTP/1.1\r\n\r\n", response));
+    CHECK(not read_http_response("HTTP/1.1 20x OK\r\n\r\n", response));
+    CHECK(not read_http_response("HTTP/1.1 2000 OK\r\n\r\n", response));
+    CHECK(not read_http_response("HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n", response));
+}
+
+std::string compress(std::string const &input, int window_bits)
+{
+    z_stream stream{};
+    REQUIRE(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) ==
+            Z_OK);
+    std::string output(deflateBound(&stream, input.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = input.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+    stream.avail_out = output.size();
+    REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+std::string chunked(std::string const &body, std::size_t chunk_size)
+{
+    std::ostringstream os;
+    for (std::size_t pos = 0; pos < body.size(); pos += chunk_size) {
+        auto chunk = body.substr(pos, chunk_size);
+        os << std::hex << chunk.size() << (pos == 0 ? ";ext=1" : "") << "\r\n" << chunk << "\r\n";
+    }
+    os << "0\r\nTrailer: x\r\n\r\n";
+    return os.str();
+}
+
+std::optional<std::string> decode(std::string const &headers, std::string const &body)
+{
+    static Http_Body_Decoder decoder;
+    std::string message = "HTTP/1.1 200 OK\r\n" + headers + "\r\n" + body;
+    Http_View response;
+    REQUIRE(read_http_response(message, response));
+    auto decoded = decoder.decode(response);
+    return decoded ? std::optional<std::string>(*decoded) : std::nullopt;
+}
+
+TEST_CASE("Remove chunked transfer encoding", "[http][unit]")
+{
+    std::string body = "The quick brown fox jumps over the lazy dog";
+    for (std::size_t chunk_size : {1, 7, 16, 100}) {
+        auto input = chunked(body, chunk_size);
+        auto size = dechunk(&input[0], input.size());
+        REQUIRE(size);
+        CHECK(input.substr(0, *size) == body);
+    }
+    std::string truncated = "5\r\nabcde\r\nA\r\nabc";
+    CHECK(dechunk(&truncated[0], truncated.size()) == 8);
+    CHECK(truncated.substr(0, 8) == "abcdeabc");
+    std::string malformed = "xyz\r\nabc";
+    CHECK(dechunk(&malformed[0], malformed.size()) == std::nullopt);
+}
+
+TEST_CASE("Decode HTTP bodies", "[http][unit]")
+{
+    std::string body;
+    for (std::size_t idx = 0; idx < 1000; ++idx) {
+        body += "line " + std::to_string(idx) + "\n";
+    }
+    CHECK(decode("", body) == body);
+    CHECK(decode("Content-Encoding: identity\r\n", body) == body);
+    CHECK(decode("Transfer-Encoding: chunked\r\n", chunked(body, 100)) == body);
+    // Bodies stored dechunked keep the header.
+    CHECK(decode("Transfer-Encoding: chunked\r\n", body) == body);
+    CHECK(decode("Content-Encoding: gzip\r\n", compress(body, 16 + MAX_WBITS)) == body);
+    CHECK(decode("Content-Encoding: X-GZIP\r\n", compress(body, 16 + MAX_WBITS)) == body);
+    CHECK(decode("Content-Encoding: deflate\r\n", compress(body, MAX_WBITS)) == body);
+    CHECK(decode("Content-Encoding: deflate\r\n", compress(body, -MAX_WBITS)) == body);
+    CHECK(decode("Transfer-Encoding: chunked\r\nContent-Encoding: gzip\r\n",
+                 chunked(compress(body, 16 + MAX_WBITS), 1000)) == body);
+    auto truncated = decode("Content-Encoding: gzip\r\n",
+                            compress(body, 16 + MAX_WBITS).substr(0, 100));
+    REQUIRE(truncated);
+    CHECK(body.substr(0, truncated->size()) == *truncated);
+    CHECK(decode("Content-Encoding: gzip\r\n", "not gzip") == std::nullopt);
+    CHECK(decode("Content-Encoding: compress\r\n", body) == std::nullopt);
+#if defined(WARCPP_BROTLI)
+    std::string brotli("\x1b\x22\x00\x00\xc4\x6d\x6c\x5d\xf7\x16\x8f\x20\x08\xd2\x29\x88\x8a\xc5"
+                       "\x70\xbd\x18\xac\x1e",
+                       23);
+    CHECK(decode("Content-Encoding: br\r\n", brotli) == "brotli body brotli body brotli body");
+#endif
+}
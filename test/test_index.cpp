@@ -0,0 +1,117 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "warcpp/index.hpp"
+
+using namespace warcpp;
+
+std::string gzip(std::string const &input)
+{
+    z_stream stream{};
+    REQUIRE(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) ==
+            Z_OK);
+    std::string output(deflateBound(&stream, input.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = input.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+    stream.avail_out = output.size();
+    REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+std::string record(std::string const &url, std::string const &content)
+{
+    return "WARC/1.0\r\n"
+           "WARC-Type: response\r\n"
+           "WARC-Target-URI: " +
+           url +
+           "\r\n"
+           "Content-Length: " +
+           std::to_string(content.size()) + "\r\n\r\n" + content + "\r\n\r\n";
+}
+
+TEST_CASE("Look up records by key", "[index][unit]")
+{
+    bool compressed = GENERATE(false, true);
+    GIVEN((compressed ? "Gzip" : "Plain") << " input")
+    {
+        std::vector<std::string> urls{
+            "http://c.com", "http://a.com", "http://b.com", "http://a.com"};
+        std::string file = "junk\n";
+        for (std::size_t idx = 0; idx < urls.size(); ++idx) {
+            auto rec = record(urls[idx], "content " + std::to_string(idx));
+            file += compressed ? gzip(rec) : rec;
+        }
+        if (compressed) {
+            auto corrupted = gzip(record("http://x.com", "lost"));
+            corrupted[corrupted.size() / 2] ^= 0x55;
+            file = file.substr(5) + corrupted;
+        }
+        std::string path = "/tmp/warcpp-index-XXXXXX";
+        close(mkstemp(&path[0]));
+        std::ofstream(path, std::ios::binary) << file;
+
+        Index_Builder builder;
+        builder.add_records(file, builder.add_file(path), Field::Warc_Target_Uri);
+        std::ostringstream os;
+        builder.write(os);
+        auto data = os.str();
+
+        Record_Index index(data);
+        REQUIRE(index.size() == 4);
+        REQUIRE(index.files().size() == 1);
+        CHECK(index.key(0) == "http://a.com");
+        CHECK(index.key(3) == "http://c.com");
+        CHECK(index.equal_range("http://a.com") == std::pair<std::size_t, std::size_t>(0, 2));
+        CHECK(index.equal_range("http://0.com") == std::pair<std::size_t, std::size_t>(0, 0));
+        CHECK(index.equal_range("http://x.com") == std::pair<std::size_t, std::size_t>(4, 4));
+        CHECK(not index.find("http://d.com"));
+
+        std::ifstream in(path, std::ios::binary);
+        std::vector<std::string> contents;
+        for (std::size_t idx = 0; idx < index.size(); ++idx) {
+            auto entry = index[idx];
+            CHECK(entry.file == path);
+            Record rec;
+            REQUIRE(not read_indexed_record(in, entry, rec));
+            CHECK(rec.url() == entry.key);
+            contents.push_back(rec.content());
+        }
+        CHECK(contents ==
+              std::vector<std::string>{"content 1", "content 3", "content 2", "content 0"});
+        auto entry = index.find("http://b.com");
+        REQUIRE(entry);
+        CHECK(file.substr(entry->offset, 5) == (compressed ? gzip("").substr(0, 5) : "WARC/"));
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("Reject malformed indexes", "[index][unit]")
+{
+    Index_Builder builder;
+    auto file = builder.add_file("a.warc");
+    builder.add("key", file, 0, 10);
+    CHECK_THROWS_AS(builder.add("key", 1, 0, 10), std::out_of_range);
+    std::ostringstream os;
+    builder.write(os);
+    auto data = os.str();
+    CHECK_NOTHROW(Record_Index(data));
+    CHECK_THROWS_AS(Record_Index(data.substr(1)), std::runtime_error);
+    CHECK_THROWS_AS(Record_Index(data.substr(0, data.size() - 3 - 40)), std::runtime_error);
+    auto bad_key = data;
+    bad_key[data.size() - 3 - 40 + 8] = 'x';
+    Record_Index index(bad_key);
+    CHECK_THROWS_AS(index.key(0), std::runtime_error);
+}
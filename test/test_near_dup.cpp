@@ -0,0 +1,107 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "warcpp/near_dup.hpp"
+
+using namespace warcpp;
+
+std::string random_text(std::mt19937 &generator, std::size_t words)
+{
+    std::string text;
+    for (std::size_t idx = 0; idx < words; ++idx) {
+        text += idx > 0 ? " " : "";
+        text += "w" + std::to_string(generator() % 10000);
+    }
+    return text;
+}
+
+double agreement(std::vector<std::uint32_t> const &lhs, std::vector<std::uint32_t> const &rhs)
+{
+    std::size_t equal = 0;
+    for (std::size_t idx = 0; idx < lhs.size(); ++idx) {
+        equal += lhs[idx] == rhs[idx] ? 1 : 0;
+    }
+    return static_cast<double>(equal) / static_cast<double>(lhs.size());
+}
+
+TEST_CASE("Compute MinHash signatures", "[near_dup][unit]")
+{
+    Minhash minhash;
+    CHECK(minhash.size() == 128);
+    std::vector<std::uint32_t> first;
+    std::vector<std::uint32_t> second;
+
+    CHECK_FALSE(minhash.signature("", first));
+    CHECK_FALSE(minhash.signature(" \n\t ", first));
+    REQUIRE(minhash.signature("two words", first));
+    REQUIRE(minhash.signature("  two \n words ", second));
+    CHECK(first == second);
+    REQUIRE(minhash.signature("two other words", second));
+    CHECK(first != second);
+
+    std::mt19937 generator(42);
+    auto text = random_text(generator, 1000);
+    REQUIRE(minhash.signature(text, first));
+    REQUIRE(minhash.signature(text, second));
+    CHECK(first == second);
+
+    // Replacing the last 100 words leaves 896 of the 996 shingles, plus 100 new ones:
+    // a Jaccard similarity of 896 / 1096.
+    std::size_t pos = 0;
+    for (int word = 0; word < 900; ++word) {
+        pos = text.find(' ', pos) + 1;
+    }
+    auto similar = text.substr(0, pos) + random_text(generator, 100);
+    REQUIRE(minhash.signature(similar, second));
+    CHECK(agreement(first, second) == Approx(896.0 / 1096.0).margin(0.1));
+
+    REQUIRE(minhash.signature(random_text(generator, 1000), second));
+    CHECK(agreement(first, second) < 0.05);
+}
+
+TEST_CASE("Find near duplicates with LSH", "[near_dup][unit]")
+{
+    Minhash minhash;
+    Lsh_Table table(minhash.bands(), std::size_t(1) << 20U);
+    CHECK(table.memory() <= (std::size_t(1) << 20U));
+    CHECK(table.memory() > (std::size_t(1) << 19U));
+
+    std::mt19937 generator(7);
+    std::vector<std::uint32_t> signature;
+    std::vector<std::uint64_t> bands;
+    auto insert = [&](std::string const &text, std::uint64_t id) {
+        REQUIRE(minhash.signature(text, signature));
+        minhash.band_hashes(signature, bands);
+        REQUIRE(bands.size() == minhash.bands());
+        return table.insert(bands, id);
+    };
+    auto original = random_text(generator, 500);
+    CHECK(insert(original, 0) == 0);
+    CHECK(insert(random_text(generator, 500), 1) == 1);
+    CHECK(insert(original, 2) == 0);
+    CHECK(insert(original + " footer", 3) == 0);
+    CHECK(insert("header " + original, 4) == 0);
+    CHECK(insert(random_text(generator, 500), 5) == 5);
+    CHECK_THROWS_AS(table.insert({1, 2, 3}, 6), std::invalid_argument);
+}
+
+TEST_CASE("Evict old entries from a full LSH table", "[near_dup][unit]")
+{
+    Lsh_Table table(1, 0);
+    CHECK(table.memory() == 4 * 16);
+    CHECK(table.insert({10}, 0) == 0);
+    CHECK(table.insert({20}, 1) == 1);
+    CHECK(table.insert({10}, 2) == 0);
+    CHECK(table.insert({30}, 3) == 3);
+    CHECK(table.insert({40}, 4) == 4);
+    CHECK(table.insert({50}, 5) == 5);
+    // 20 was the least recently used of the four entries.
+    CHECK(table.insert({20}, 6) == 6);
+    CHECK(table.insert({10}, 7) == 7);
+    CHECK(table.insert({50}, 8) == 5);
+}
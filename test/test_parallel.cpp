@@ -0,0 +1,266 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "warcpp/parallel.hpp"
+
+using namespace warcpp;
+
+std::string gzip(std::string const &input)
+{
+    z_stream stream{};
+    REQUIRE(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) ==
+            Z_OK);
+    std::string output(deflateBound(&stream, input.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = input.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+    stream.avail_out = output.size();
+    REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+std::string record(std::size_t idx)
+{
+    std::string content = "content " + std::to_string(idx) + std::string(idx % 97, '\x1f');
+    return "WARC/1.0\r\n"
+           "WARC-Type: response\r\n"
+           "WARC-TREC-ID: " +
+           std::to_string(idx) +
+           "\r\n"
+           "Content-Length: " +
+           std::to_string(content.size()) + "\r\n\r\n" + content + "\r\n\r\n";
+}
+
+TEST_CASE("Reorder results computed in parallel", "[parallel][unit]")
+{
+    std::size_t threads = GENERATE(as<std::size_t>(), 1, 4);
+    std::size_t window = GENERATE(as<std::size_t>(), 1, 3, 100);
+    std::vector<std::size_t> output;
+    detail::ordered_parallel_for(
+        1000,
+        [](std::size_t idx) { return idx * 2; },
+        [&](std::size_t value) { output.push_back(value); },
+        threads,
+        window);
+    REQUIRE(output.size() == 1000);
+    for (std::size_t idx = 0; idx < output.size(); ++idx) {
+        REQUIRE(output[idx] == idx * 2);
+    }
+}
+
+TEST_CASE("Propagate exceptions from workers", "[parallel][unit]")
+{
+    auto run = [] {
+        detail::ordered_parallel_for(
+            100,
+            [](std::size_t idx) {
+                if (idx == 50) {
+                    throw std::runtime_error("worker");
+                }
+                return idx;
+            },
+            [](std::size_t) {},
+            4,
+            8);
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+}
+
+TEST_CASE("Pass items through a bounded queue", "[parallel][unit]")
+{
+    detail::Bounded_Queue<std::size_t> queue(3);
+    std::size_t value = 0;
+    CHECK(not queue.try_pop(value));
+    for (std::size_t idx = 0; idx < 4; ++idx) {
+        CHECK(queue.try_push(idx));
+    }
+    CHECK(not queue.try_push(4));
+    for (std::size_t idx = 0; idx < 4; ++idx) {
+        REQUIRE(queue.try_pop(value));
+        CHECK(value == idx);
+    }
+    CHECK(not queue.try_pop(value));
+}
+
+TEST_CASE("Share a bounded queue between threads", "[parallel][unit]")
+{
+    detail::Bounded_Queue<std::size_t> queue(16);
+    std::size_t count = 10000;
+    std::atomic_size_t sum{0};
+    std::atomic_size_t popped{0};
+    std::vector<std::thread> threads;
+    for (std::size_t producer = 0; producer < 2; ++producer) {
+        threads.emplace_back([&, producer] {
+            for (std::size_t idx = producer; idx < count; idx += 2) {
+                while (not queue.try_push(idx)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::size_t consumer = 0; consumer < 2; ++consumer) {
+        threads.emplace_back([&] {
+            std::size_t value = 0;
+            while (popped < count) {
+                if (queue.try_pop(value)) {
+                    sum += value;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK(sum == count * (count - 1) / 2);
+}
+
+TEST_CASE("Keep batch order in a pipeline", "[parallel][unit]")
+{
+    struct Batch {
+        std::size_t first = 0;
+        std::vector<std::size_t> values{};
+    };
+    std::size_t threads = GENERATE(as<std::size_t>(), 1, 4);
+    std::size_t depth = GENERATE(as<std::size_t>(), 1, 2, 16);
+    std::size_t next = 0;
+    std::vector<std::size_t> output;
+    detail::ordered_pipeline<Batch>(
+        [&](Batch &batch) {
+            batch.first = next;
+            next += 10;
+            return batch.first < 1000;
+        },
+        [](Batch &batch) {
+            batch.values.clear();
+            for (std::size_t idx = 0; idx < 10; ++idx) {
+                batch.values.push_back((batch.first + idx) * 2);
+            }
+        },
+        [&](Batch &batch) {
+            output.insert(output.end(), batch.values.begin(), batch.values.end());
+        },
+        threads,
+        depth);
+    REQUIRE(output.size() == 1000);
+    for (std::size_t idx = 0; idx < output.size(); ++idx) {
+        REQUIRE(output[idx] == idx * 2);
+    }
+}
+
+TEST_CASE("Propagate exceptions from pipeline stages", "[parallel][unit]")
+{
+    auto stage = GENERATE(0, 1, 2);
+    auto check = [=](int current, std::size_t value) {
+        if (current == stage && value == 50) {
+            throw std::runtime_error("stage");
+        }
+    };
+    std::size_t next = 0;
+    auto run = [&] {
+        detail::ordered_pipeline<std::size_t>(
+            [&](std::size_t &value) {
+                value = next++;
+                check(0, value);
+                return true;
+            },
+            [&](std::size_t &value) { check(1, value); },
+            [&](std::size_t &value) { check(2, value); },
+            2,
+            4);
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+}
+
+TEST_CASE("Balance tasks by work stealing", "[parallel][unit]")
+{
+    std::size_t count = GENERATE(as<std::size_t>(), 0, 1, 7, 100);
+    std::size_t threads = GENERATE(as<std::size_t>(), 1, 3, 16);
+    std::vector<std::atomic_size_t> calls(count);
+    detail::work_stealing_for(
+        count,
+        [&](std::size_t idx) {
+            if (idx == 0) {
+                // A long task: the thread holding it should get help with the rest of its block.
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            ++calls[idx];
+        },
+        threads);
+    for (auto const &call : calls) {
+        REQUIRE(call == 1);
+    }
+}
+
+TEST_CASE("Propagate exceptions from stolen tasks", "[parallel][unit]")
+{
+    auto run = [] {
+        detail::work_stealing_for(
+            50,
+            [](std::size_t idx) {
+                if (idx == 49) {
+                    throw std::runtime_error("task");
+                }
+            },
+            4);
+    };
+    REQUIRE_THROWS_AS(run(), std::runtime_error);
+}
+
+TEST_CASE("Decode gzip members in parallel", "[parallel][unit]")
+{
+    std::size_t count = 500;
+    std::string file;
+    std::vector<std::uint64_t> offsets;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        offsets.push_back(file.size());
+        file += gzip(record(idx));
+    }
+    bool use_index = GENERATE(false, true);
+    GIVEN("Member offsets " << (use_index ? "given" : "scanned"))
+    {
+        Parallel_Options options;
+        options.threads = 4;
+        options.window = 16;
+        if (use_index) {
+            options.member_offsets = offsets;
+        }
+        std::vector<std::string> trecids;
+        parallel_read(
+            file,
+            [&](Result result) {
+                REQUIRE(holds_record(result));
+                trecids.push_back(std::get<Record>(result).trecid());
+            },
+            options);
+        REQUIRE(trecids.size() == count);
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            REQUIRE(trecids[idx] == std::to_string(idx));
+        }
+    }
+}
+
+TEST_CASE("Skip corrupted members in parallel", "[parallel][unit]")
+{
+    std::string corrupted = gzip(record(1));
+    corrupted[corrupted.size() / 2] ^= 0x55;
+    std::string file = gzip(record(0)) + corrupted + gzip(record(2));
+    std::vector<std::string> trecids;
+    parallel_read(file, [&](Result result) {
+        if (holds_record(result)) {
+            trecids.push_back(std::get<Record>(result).trecid());
+        }
+    });
+    CHECK(trecids == std::vector<std::string>{"0", "2"});
+}